@@ -0,0 +1,583 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "tau.h"
+
+/*
+ * Micro-benchmarks. Run all of them with `./bench_tau`, or a single one
+ * with `./bench_tau <name>`.
+ */
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Keeps results observable so the compiler cannot drop the measured loops. */
+static volatile double bench_sink;
+
+static void report(const char *name, double seconds, size_t items) {
+    printf("%-32s %10.3f ms %10.2f ns/item\n", name, seconds * 1e3, seconds * 1e9 / items);
+}
+
+
+/* ----------------------------------------------------------------------
+ * Struct storage: AoS vs SoA
+ * ---------------------------------------------------------------------- */
+
+#define STRUCT_RECORDS 4000000
+#define STRUCT_PASSES  10
+
+static StructRegistry bench_registry;
+
+static const StructLayout *bench_define(const char *source) {
+    Buffer *buf __attribute__ ((__cleanup__(buffer_cleanup))) = buffer_create(sizeof(Marker), 64);
+    size_t index = 2;  // Skip "(" and "struct".
+    const StructLayout *layout = NULL;
+    if (read_markers(source, buf) != RETURN_STATUS_SUCCESS ||
+        struct_define_from_markers(&bench_registry, &index, buf, source, &layout) != RETURN_STATUS_SUCCESS) {
+        fprintf(stderr, "Error defining benchmark struct: %s\n", source);
+        exit(1);
+    }
+    return layout;
+}
+
+/* Sum one f64 column: touches a single field of every record. */
+static double scan_column(StructVec *vec, size_t field) {
+    size_t stride;
+    const char *p = struct_vec_column(vec, field, &stride);
+    double sum = 0;
+    for (size_t i = 0; i < vec->count; i++, p += stride)
+        sum += *(const double *)p;
+    return sum;
+}
+
+/* x += vx over every record: reads two columns, writes one. */
+static void update_column(StructVec *vec, size_t x_field, size_t vx_field) {
+    size_t x_stride, vx_stride;
+    char *x = struct_vec_column(vec, x_field, &x_stride);
+    const char *vx = struct_vec_column(vec, vx_field, &vx_stride);
+    for (size_t i = 0; i < vec->count; i++, x += x_stride, vx += vx_stride)
+        *(double *)x += *(const double *)vx;
+}
+
+/* Count records with a positive i8 coordinate. */
+static size_t scan_point(StructVec *vec, size_t field) {
+    size_t stride;
+    const char *p = struct_vec_column(vec, field, &stride);
+    size_t hits = 0;
+    for (size_t i = 0; i < vec->count; i++, p += stride)
+        hits += *(const int8_t *)p > 0;
+    return hits;
+}
+
+static StructVec *fill(const StructLayout *layout, StructStorage storage) {
+    StructVec *vec = struct_vec_create(layout, storage, STRUCT_RECORDS);
+    if (!vec) {
+        fprintf(stderr, "Error allocating struct vector\n");
+        exit(1);
+    }
+    for (size_t i = 0; i < STRUCT_RECORDS; i++)
+        struct_vec_push(vec, NULL);
+    for (size_t f = 0; f < layout->field_count; f++) {
+        for (size_t i = 0; i < STRUCT_RECORDS; i++) {
+            void *p = struct_vec_field(vec, i, f);
+            switch (layout->fields[f].type) {
+                case FIELD_F64: *(double *)p = (double)(i % 97); break;
+                case FIELD_I8:  *(int8_t *)p = (int8_t)(i % 251); break;
+                default: break;
+            }
+        }
+    }
+    return vec;
+}
+
+static void bench_structs(void) {
+    const StructLayout *point = bench_define("(struct point-2d ((x i8) (y i8)))");
+    const StructLayout *particle = bench_define(
+        "(struct particle ((id i32) (x f64) (y f64) (z f64)"
+        " (vx f64) (vy f64) (vz f64) (mass f32)))");
+    printf("point-2d: %zu bytes, particle: %zu bytes, %d records\n",
+           point->size, particle->size, STRUCT_RECORDS);
+
+    static const struct { StructStorage storage; const char *name; } modes[] = {
+        { STRUCT_STORAGE_AOS, "aos" },
+        { STRUCT_STORAGE_SOA, "soa" },
+    };
+    char label[64];
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        StructVec *vec __attribute__ ((__cleanup__(struct_vec_cleanup))) = fill(particle, modes[m].storage);
+        double t0 = now_seconds();
+        for (int pass = 0; pass < STRUCT_PASSES; pass++)
+            bench_sink += scan_column(vec, 1);
+        snprintf(label, sizeof(label), "particle scan x (%s)", modes[m].name);
+        report(label, now_seconds() - t0, (size_t)STRUCT_RECORDS * STRUCT_PASSES);
+
+        t0 = now_seconds();
+        for (int pass = 0; pass < STRUCT_PASSES; pass++)
+            update_column(vec, 1, 4);
+        snprintf(label, sizeof(label), "particle x += vx (%s)", modes[m].name);
+        report(label, now_seconds() - t0, (size_t)STRUCT_RECORDS * STRUCT_PASSES);
+
+        StructVec *points __attribute__ ((__cleanup__(struct_vec_cleanup))) = fill(point, modes[m].storage);
+        t0 = now_seconds();
+        for (int pass = 0; pass < STRUCT_PASSES; pass++)
+            bench_sink += scan_point(points, 0);
+        snprintf(label, sizeof(label), "point-2d scan x (%s)", modes[m].name);
+        report(label, now_seconds() - t0, (size_t)STRUCT_RECORDS * STRUCT_PASSES);
+    }
+    struct_registry_destroy(&bench_registry);
+}
+
+
+/* ----------------------------------------------------------------------
+ * Lists: cons allocation through the copying heap
+ * ---------------------------------------------------------------------- */
+
+#define LIST_LENGTH 1000
+#define LIST_ROUNDS 10000
+
+/* Build LIST_ROUNDS lists of LIST_LENGTH cells, keeping only the last one live. */
+static void bench_heap_cons(void) {
+    Heap heap;
+    if (heap_init(&heap, HEAP_INITIAL_SEMISPACE) != RETURN_STATUS_SUCCESS) {
+        fprintf(stderr, "Error creating heap\n");
+        exit(1);
+    }
+    Value list = { .type = VALUE_NIL };
+    Value item = { .type = VALUE_INT };
+    heap_root_push(&heap, &list);
+    double t0 = now_seconds();
+    for (int round = 0; round < LIST_ROUNDS; round++) {
+        list.type = VALUE_NIL;
+        for (int i = 0; i < LIST_LENGTH; i++) {
+            item.as.i = i;
+            heap_cons(&heap, &item, &list, &list);
+        }
+    }
+    report("heap_cons", now_seconds() - t0, (size_t)LIST_ROUNDS * LIST_LENGTH);
+    heap_print_stats(&heap);
+    heap_destroy(&heap);
+}
+
+/* The same workload with one malloc and one free per cell. */
+static void bench_malloc_cons(void) {
+    double t0 = now_seconds();
+    for (int round = 0; round < LIST_ROUNDS; round++) {
+        Cons *list = NULL;
+        for (int i = 0; i < LIST_LENGTH; i++) {
+            Cons *c = malloc(sizeof(Cons));
+            c->car.type = VALUE_INT;
+            c->car.as.i = i;
+            c->cdr.type = list ? VALUE_CONS : VALUE_NIL;
+            c->cdr.as.cons = list;
+            list = c;
+        }
+        while (list) {
+            Cons *next = list->cdr.type == VALUE_CONS ? list->cdr.as.cons : NULL;
+            free(list);
+            list = next;
+        }
+    }
+    report("malloc/free cons", now_seconds() - t0, (size_t)LIST_ROUNDS * LIST_LENGTH);
+}
+
+/* Evaluate list-processing expressions through the interpreter. */
+static void bench_eval_lists(void) {
+    char *source = malloc(LIST_LENGTH * 8 + 128);
+    size_t len = sprintf(source, "(length (reverse (append '(");
+    for (int i = 0; i < LIST_LENGTH; i++)
+        len += sprintf(source + len, "%d ", i);
+    len += sprintf(source + len, ") (list 1 2 3))))");
+
+    Interp interp __attribute__ ((__cleanup__(interp_destroy)));
+    Buffer *buf __attribute__ ((__cleanup__(buffer_cleanup))) = buffer_create(sizeof(Marker), 4096);
+    if (interp_init(&interp) != RETURN_STATUS_SUCCESS || read_markers(source, buf) != RETURN_STATUS_SUCCESS) {
+        fprintf(stderr, "Error preparing list benchmark\n");
+        exit(1);
+    }
+    int rounds = LIST_ROUNDS / 10;
+    double t0 = now_seconds();
+    for (int round = 0; round < rounds; round++) {
+        size_t index = 0;
+        Value result;
+        interp_eval(&interp, buf, source, &index, &result);
+        bench_sink += result.as.i;
+    }
+    report("eval append/reverse/length", now_seconds() - t0, (size_t)rounds * LIST_LENGTH * 2);
+    heap_print_stats(&interp.heap);
+    free(source);
+}
+
+static void bench_lists(void) {
+    bench_heap_cons();
+    bench_malloc_cons();
+    bench_eval_lists();
+}
+
+
+/* ----------------------------------------------------------------------
+ * Startup: lexing vs mapping a precompiled image
+ * ---------------------------------------------------------------------- */
+
+#define IMAGE_RULES 200000
+#define IMAGE_PATH  "/tmp/bench_tau.img"
+
+/*
+ * Evaluate a whole program on a fresh interpreter, destroyed afterwards so
+ * one pass does not inherit another's grown tables and heap. With an image,
+ * the interpreter binds it first, outside the timing.
+ */
+static double eval_pass(Buffer *markers, Image *image, const char *source) {
+    Interp interp __attribute__ ((__cleanup__(interp_destroy)));
+    if (interp_init(&interp) != RETURN_STATUS_SUCCESS ||
+        (image && image_bind(image, &interp.symbols) != RETURN_STATUS_SUCCESS)) {
+        fprintf(stderr, "Error creating interpreter\n");
+        exit(1);
+    }
+    double t0 = now_seconds();
+    for (size_t index = 0; index < markers->count;) {
+        Value result;
+        if (image)
+            interp_eval_image(&interp, image, source, &index, &result);
+        else
+            interp_eval(&interp, markers, source, &index, &result);
+    }
+    return now_seconds() - t0;
+}
+
+static void bench_image(void) {
+    static const char *rule =
+        "(struct rule-%d ((weight f64) (hits i32) (flags u8)))\n"
+        "(+ %d (* 3 4) (- 10 2))\n"
+        "'(rule-%d matches (a b c) \"pattern\" #t nil)\n";
+    size_t cap = IMAGE_RULES * 160;
+    char *source = malloc(cap);
+    size_t len = 0;
+    for (int i = 0; i < IMAGE_RULES; i++)
+        len += snprintf(source + len, cap - len, rule, i, i, i);
+
+    remove(IMAGE_PATH);
+    double t0 = now_seconds();
+    Buffer *buf __attribute__ ((__cleanup__(buffer_cleanup))) = buffer_create(sizeof(Marker), 1024);
+    read_markers(source, buf);
+    double lex = now_seconds() - t0;
+    t0 = now_seconds();
+    if (image_write(IMAGE_PATH, source, len, buf) != RETURN_STATUS_SUCCESS) {
+        fprintf(stderr, "Error writing %s\n", IMAGE_PATH);
+        exit(1);
+    }
+    double write = now_seconds() - t0;
+
+    Interp interp __attribute__ ((__cleanup__(interp_destroy)));
+    interp_init(&interp);
+    Image image;
+    t0 = now_seconds();
+    if (image_open(&image, IMAGE_PATH, source, len) != RETURN_STATUS_SUCCESS ||
+        image_bind(&image, &interp.symbols) != RETURN_STATUS_SUCCESS) {
+        fprintf(stderr, "Error opening %s\n", IMAGE_PATH);
+        exit(1);
+    }
+    double open = now_seconds() - t0;
+
+    printf("%zu bytes of source, %zu markers, %zu symbols\n", len, buf->count, image.symbol_count);
+    report("cold: read_markers", lex, buf->count);
+    report("cold: image_write", write, buf->count);
+    report("warm: image_open + image_bind", open, buf->count);
+
+    report("eval lexed markers", eval_pass(buf, NULL, source), buf->count);
+    report("eval image markers", eval_pass(&image.markers, &image, source), buf->count);
+
+    image_close(&image);
+    remove(IMAGE_PATH);
+    free(source);
+}
+
+
+/* ----------------------------------------------------------------------
+ * Strings: lexing string-heavy configs and interning literals
+ * Build with BENCH_CFLAGS+=-DTAU_NO_SIMD for the scalar baseline.
+ * ---------------------------------------------------------------------- */
+
+#define STRING_LINES 200000
+
+static void bench_strings(void) {
+    static const char *line =
+        "(define x \"abcdef\")\n"
+        "(printf \"Hello World! \")\n"
+        "(define motd-%d \"Welcome to the server; maintenance runs nightly between two and four.\")\n"
+        "(printf \"line %d:\\tcolumn\\t\\\"value\\\"\\n\")\n";
+    size_t cap = STRING_LINES * 200;
+    char *source = malloc(cap);
+    size_t len = 0;
+    for (int i = 0; i < STRING_LINES; i++)
+        len += snprintf(source + len, cap - len, line, i % 100, i % 100);
+#if defined(__SSE2__) && !defined(TAU_NO_SIMD)
+    printf("%zu bytes, SSE2 string scan\n", len);
+#else
+    printf("%zu bytes, scalar string scan\n", len);
+#endif
+
+    Buffer *buf __attribute__ ((__cleanup__(buffer_cleanup))) = buffer_create(sizeof(Marker), 1024);
+    double t0 = now_seconds();
+    for (int pass = 0; pass < 5; pass++) {
+        buffer_clear(buf);
+        read_markers(source, buf);
+    }
+    double lex = (now_seconds() - t0) / 5;
+    printf("%-32s %10.3f ms %10.2f MB/s\n", "read_markers", lex * 1e3, len / (lex * 1e6));
+
+    /* Evaluate every string literal; repeated literals hit the intern table. */
+    Interp interp __attribute__ ((__cleanup__(interp_destroy)));
+    interp_init(&interp);
+    size_t literals = 0;
+    t0 = now_seconds();
+    for (size_t i = 0; i < buf->count; i++) {
+        Marker *m = (Marker *)buffer_nth(buf, i);
+        if (m->type != MARKER_STRING)
+            continue;
+        size_t index = i;
+        Value result;
+        interp_eval(&interp, buf, source, &index, &result);
+        bench_sink += result.as.string.len;
+        literals++;
+    }
+    report("eval string literals", now_seconds() - t0, literals);
+    printf("%zu literals, %zu distinct strings stored\n", literals, interp.strings.symbols->count);
+    free(source);
+}
+
+
+/* ----------------------------------------------------------------------
+ * Branches: untaken branches of growing size
+ * ---------------------------------------------------------------------- */
+
+#define BRANCH_EVALS 200000
+
+/* Source for fmt with each %s replaced by a dead expression of `terms` terms. */
+static char *branch_source(const char *fmt, size_t terms) {
+    size_t cap = strlen(fmt) + terms * 24 + 64;
+    char *dead = malloc(cap);
+    char *source = malloc(cap * 2);
+    size_t len = snprintf(dead, cap, "(+");
+    for (size_t i = 0; i < terms; i++)
+        len += snprintf(dead + len, cap - len, i % 8 ? " %zu" : " (* %zu 2)", i);
+    snprintf(dead + len, cap - len, ")");
+    snprintf(source, cap * 2, fmt, dead, dead);
+    free(dead);
+    return source;
+}
+
+static void bench_branches(void) {
+    static const struct {
+        const char *name;
+        const char *fmt;
+    } forms[] = {
+        { "if dead else",     "(if (< 1 2) 1 %s)" },
+        { "if dead then",     "(if (>= 1 2) %s 1)" },
+        { "cond dead tests",  "(cond ((= 1 2) %s) ((> 1 2) %s) (else 1))" },
+        { "and/or dead rest", "(or (and #f %s) (= 1 1) %s)" },
+    };
+    static const size_t sizes[] = { 1, 100, 10000 };
+
+    Interp interp __attribute__ ((__cleanup__(interp_destroy)));
+    interp_init(&interp);
+    Buffer *buf __attribute__ ((__cleanup__(buffer_cleanup))) = buffer_create(sizeof(Marker), 1024);
+    for (size_t f = 0; f < sizeof(forms) / sizeof(forms[0]); f++) {
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+            char *source = branch_source(forms[f].fmt, sizes[s]);
+            buffer_clear(buf);
+            read_markers(source, buf);
+            double t0 = now_seconds();
+            for (int i = 0; i < BRANCH_EVALS; i++) {
+                size_t index = 0;
+                Value result;
+                if (interp_eval(&interp, buf, source, &index, &result) != RETURN_STATUS_SUCCESS) {
+                    fprintf(stderr, "Error evaluating branch benchmark: %s\n", forms[f].name);
+                    exit(1);
+                }
+                bench_sink += result.as.i;
+            }
+            char name[64];
+            snprintf(name, sizeof(name), "%s (%zu markers)", forms[f].name, buf->count);
+            report(name, now_seconds() - t0, BRANCH_EVALS);
+            free(source);
+        }
+    }
+}
+
+
+/* ----------------------------------------------------------------------
+ * Integers: int64 fast path and bignum promotion
+ * ---------------------------------------------------------------------- */
+
+/* Evaluate the single expression in source `runs` times; returns seconds per run. */
+static double time_expr(Interp *interp, const char *source, int runs, Value *result) {
+    Buffer *buf __attribute__ ((__cleanup__(buffer_cleanup))) = buffer_create(sizeof(Marker), 1024);
+    read_markers(source, buf);
+    double t0 = now_seconds();
+    for (int i = 0; i < runs; i++) {
+        size_t index = 0;
+        if (interp_eval(interp, buf, source, &index, result) != RETURN_STATUS_SUCCESS) {
+            fprintf(stderr, "Error evaluating benchmark expression\n");
+            exit(1);
+        }
+    }
+    return (now_seconds() - t0) / runs;
+}
+
+/* "(op first first+step ...)" with n operands. */
+static char *operand_list(const char *op, long first, long step, size_t n) {
+    char *source = malloc(n * 24 + 16);
+    size_t len = sprintf(source, "(%s", op);
+    for (size_t i = 0; i < n; i++)
+        len += sprintf(source + len, " %ld", first + (long)i * step);
+    strcpy(source + len, ")");
+    return source;
+}
+
+static void bench_numbers(void) {
+    Interp interp __attribute__ ((__cleanup__(interp_destroy)));
+    interp_init(&interp);
+    Value result = { .type = VALUE_NIL };
+    heap_root_push(&interp.heap, &result);
+
+    // Per-operand cost while everything fits in int64.
+    char *source = operand_list("+", 1, 1, 1000);
+    report("int64 (+ 1 .. 1000), per term", time_expr(&interp, source, 20000, &result), 1000);
+    free(source);
+    source = operand_list("*", 1, 0, 1000);
+    report("int64 (* 1 1 ..), per term", time_expr(&interp, source, 20000, &result), 1000);
+    free(source);
+
+    // 1000! = (* 1 2 .. 1000): a growing bignum times a small int.
+    source = operand_list("*", 1, 1, 1000);
+    report("factorial 1000", time_expr(&interp, source, 200, &result), 1);
+    free(source);
+
+    // Sum of k^60 for k = 1 .. 200, one (* k k ..) per term.
+    size_t cap = 200 * 60 * 5 + 16, len = sprintf(source = malloc(cap), "(+");
+    for (int k = 1; k <= 200; k++) {
+        len += sprintf(source + len, " (*");
+        for (int e = 0; e < 60; e++)
+            len += sprintf(source + len, " %d", k);
+        len += sprintf(source + len, ")");
+    }
+    strcpy(source + len, ")");
+    report("power sum k^60, k <= 200", time_expr(&interp, source, 200, &result), 1);
+    free(source);
+
+    // Squaring n!: Karatsuba once the operands reach 32 limbs.
+    static const int factorials[] = { 100, 1000, 5000, 20000 };
+    for (size_t f = 0; f < sizeof(factorials) / sizeof(factorials[0]); f++) {
+        source = operand_list("*", 1, 1, factorials[f]);
+        time_expr(&interp, source, 1, &result);
+        free(source);
+        int runs = factorials[f] >= 5000 ? 20 : 2000;
+        Value square = { .type = VALUE_NIL };
+        heap_root_push(&interp.heap, &square);
+        double t0 = now_seconds();
+        for (int i = 0; i < runs; i++)
+            bignum_mul(&interp.heap, &result, &result, &square);
+        char name[64];
+        snprintf(name, sizeof(name), "square %d! (%zu limbs)", factorials[f], result.as.bignum->len);
+        report(name, (now_seconds() - t0) / runs, 1);
+        heap_root_restore(&interp.heap, interp.heap.roots->count - 1);
+    }
+}
+
+
+/* ----------------------------------------------------------------------
+ * Macro expansion: first pass vs cached, and evaluation, timed apart
+ * ---------------------------------------------------------------------- */
+
+#define MACRO_CALLS 20000
+#define MACRO_RUNS  20
+
+static const char macro_defs[] =
+    "(define-syntax swap (syntax-rules () ((_ a b) (list b a))))\n"
+    "(define-syntax my-or (syntax-rules () ((_) #f) ((_ e r ...) (if e e (my-or r ...)))))\n";
+
+/* Expand source with interp's expander, returning seconds. */
+static double time_expand(Interp *interp, Buffer *markers, const char *source, Buffer *text, Buffer *expanded) {
+    double t0 = now_seconds();
+    if (interp_expand(interp, markers, source, text, expanded) != RETURN_STATUS_SUCCESS) {
+        fprintf(stderr, "Error expanding benchmark program\n");
+        exit(1);
+    }
+    return now_seconds() - t0;
+}
+
+static void bench_macros(void) {
+    // MACRO_CALLS top-level calls; call sites differ unless same_site is set.
+    for (int same_site = 0; same_site <= 1; same_site++) {
+        size_t cap = sizeof(macro_defs) + MACRO_CALLS * 40, len = 0;
+        char *source = malloc(cap);
+        len += sprintf(source, "%s", macro_defs);
+        for (int i = 0; i < MACRO_CALLS; i++)
+            len += sprintf(source + len, "(my-or #f #f (swap 1 %d))\n", same_site ? 0 : i);
+        Buffer *markers __attribute__ ((__cleanup__(buffer_cleanup))) = buffer_create(sizeof(Marker), 1024);
+        Buffer *text __attribute__ ((__cleanup__(buffer_cleanup))) = buffer_create(sizeof(char), 1024);
+        Buffer *expanded __attribute__ ((__cleanup__(buffer_cleanup))) = buffer_create(sizeof(Marker), 1024);
+        read_markers(source, markers);
+
+        // A fresh interpreter per run, so every run starts with an empty cache.
+        double first = 1e9, cached = 1e9, eval = 1e9;
+        for (int r = 0; r < MACRO_RUNS; r++) {
+            Interp interp __attribute__ ((__cleanup__(interp_destroy)));
+            interp_init(&interp);
+            double t = time_expand(&interp, markers, source, text, expanded);
+            if (t < first)
+                first = t;
+            if ((t = time_expand(&interp, markers, source, text, expanded)) < cached)
+                cached = t;
+            double t0 = now_seconds();
+            size_t index = 0;
+            while (index < expanded->count) {
+                Value result;
+                if (interp_eval(&interp, expanded, text->data, &index, &result) != RETURN_STATUS_SUCCESS)
+                    exit(1);
+                bench_sink += result.type;
+            }
+            if ((t = now_seconds() - t0) < eval)
+                eval = t;
+        }
+        const char *sites = same_site ? "one site" : "distinct sites";
+        char name[64];
+        snprintf(name, sizeof(name), "expand first, %s", sites);
+        report(name, first, MACRO_CALLS);
+        snprintf(name, sizeof(name), "expand cached, %s", sites);
+        report(name, cached, MACRO_CALLS);
+        snprintf(name, sizeof(name), "eval expanded, %s", sites);
+        report(name, eval, MACRO_CALLS);
+        free(source);
+    }
+}
+
+
+static const struct {
+    const char *name;
+    void (*run)(void);
+} benchmarks[] = {
+    { "structs",  bench_structs },
+    { "lists",    bench_lists },
+    { "image",    bench_image },
+    { "strings",  bench_strings },
+    { "branches", bench_branches },
+    { "numbers",  bench_numbers },
+    { "macros",   bench_macros },
+};
+
+int main(int argc, char **argv) {
+    const char *only = argc > 1 ? argv[1] : NULL;
+    for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+        if (only && strcmp(only, benchmarks[i].name) != 0)
+            continue;
+        printf("== %s ==\n", benchmarks[i].name);
+        benchmarks[i].run();
+    }
+    return 0;
+}
@@ -0,0 +1,325 @@
+#include "tau.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/* Operands at least this many limbs long are multiplied with Karatsuba. */
+#define KARATSUBA_THRESHOLD 32
+
+/* Largest power of ten that fits in a limb, and its exponent. */
+#define LIMB_DECIMAL_BASE 10000000000000000000ULL
+#define LIMB_DECIMAL_DIGITS 19
+
+typedef unsigned __int128 uint128_t;
+
+/*
+ * Operand: Sign and magnitude view of an INT or BIGNUM value. Views point
+ * into the heap, so they must be taken after the last allocation of an
+ * operation. The magnitude of an int lives in small, so an Operand must not
+ * be copied after operand_init.
+ */
+typedef struct {
+    const uint64_t *limbs;
+    size_t len;
+    int negative;
+    uint64_t small;
+} Operand;
+
+static void operand_init(Operand *op, const Value *v) {
+    if (v->type == VALUE_INT) {
+        op->negative = v->as.i < 0;
+        op->small = op->negative ? 0 - (uint64_t)v->as.i : (uint64_t)v->as.i;
+        op->limbs = &op->small;
+        op->len = op->small != 0;
+    } else {
+        op->limbs = v->as.bignum->limbs;
+        op->len = v->as.bignum->len;
+        op->negative = v->as.bignum->negative;
+    }
+}
+
+/* Limb count of an operand, without building a view. */
+static size_t value_len(const Value *v) {
+    return v->type == VALUE_INT ? 1 : v->as.bignum->len;
+}
+
+static size_t mag_trim(const uint64_t *a, size_t len) {
+    while (len > 0 && a[len - 1] == 0)
+        len--;
+    return len;
+}
+
+static int mag_cmp(const uint64_t *a, size_t alen, const uint64_t *b, size_t blen) {
+    if (alen != blen)
+        return alen < blen ? -1 : 1;
+    for (size_t i = alen; i-- > 0;) {
+        if (a[i] != b[i])
+            return a[i] < b[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+/* r = a + b. r needs max(alen, blen) + 1 limbs; returns the trimmed length. */
+static size_t mag_add(uint64_t *r, const uint64_t *a, size_t alen, const uint64_t *b, size_t blen) {
+    if (alen < blen) {
+        const uint64_t *t = a; a = b; b = t;
+        size_t n = alen; alen = blen; blen = n;
+    }
+    uint64_t carry = 0;
+    for (size_t i = 0; i < alen; i++) {
+        uint128_t sum = (uint128_t)a[i] + (i < blen ? b[i] : 0) + carry;
+        r[i] = (uint64_t)sum;
+        carry = (uint64_t)(sum >> 64);
+    }
+    r[alen] = carry;
+    return mag_trim(r, alen + 1);
+}
+
+/* r = a - b for a >= b. r may alias a; returns the trimmed length. */
+static size_t mag_sub(uint64_t *r, const uint64_t *a, size_t alen, const uint64_t *b, size_t blen) {
+    uint64_t borrow = 0;
+    for (size_t i = 0; i < alen; i++) {
+        uint64_t bi = i < blen ? b[i] : 0;
+        uint64_t d = a[i] - bi - borrow;
+        borrow = (a[i] < bi) || (a[i] - bi < borrow);
+        r[i] = d;
+    }
+    return mag_trim(r, alen);
+}
+
+/* r[0, rlen) += b; the sum must fit in rlen limbs. */
+static void mag_add_into(uint64_t *r, size_t rlen, const uint64_t *b, size_t blen) {
+    uint64_t carry = 0;
+    size_t i = 0;
+    for (; i < blen; i++) {
+        uint128_t sum = (uint128_t)r[i] + b[i] + carry;
+        r[i] = (uint64_t)sum;
+        carry = (uint64_t)(sum >> 64);
+    }
+    for (; carry && i < rlen; i++)
+        carry = ++r[i] == 0;
+}
+
+static void mag_mul_schoolbook(uint64_t *r, const uint64_t *a, size_t alen, const uint64_t *b, size_t blen) {
+    for (size_t i = 0; i < alen; i++) {
+        uint64_t carry = 0;
+        for (size_t j = 0; j < blen; j++) {
+            uint128_t t = (uint128_t)a[i] * b[j] + r[i + j] + carry;
+            r[i + j] = (uint64_t)t;
+            carry = (uint64_t)(t >> 64);
+        }
+        r[i + blen] = carry;
+    }
+}
+
+/*
+ * r = a * b, with r zeroed and alen + blen limbs long. Short operands use
+ * schoolbook multiplication; long ones split in half with Karatsuba, which
+ * needs three half-size products instead of four. Very unbalanced operands
+ * are multiplied in chunks of the shorter one's size so that both halves of
+ * every split stay useful. Returns 0 if scratch memory could not be had.
+ */
+static int mag_mul(uint64_t *r, const uint64_t *a, size_t alen, const uint64_t *b, size_t blen) {
+    if (alen < blen) {
+        const uint64_t *t = a; a = b; b = t;
+        size_t n = alen; alen = blen; blen = n;
+    }
+    if (blen < KARATSUBA_THRESHOLD) {
+        mag_mul_schoolbook(r, a, alen, b, blen);
+        return 1;
+    }
+
+    if (2 * blen <= alen) {
+        uint64_t *part = malloc(2 * blen * sizeof(uint64_t));
+        if (!part)
+            return 0;
+        for (size_t off = 0; off < alen; off += blen) {
+            size_t n = alen - off < blen ? alen - off : blen;
+            memset(part, 0, (n + blen) * sizeof(uint64_t));
+            if (!mag_mul(part, a + off, n, b, blen)) {
+                free(part);
+                return 0;
+            }
+            mag_add_into(r + off, alen + blen - off, part, n + blen);
+        }
+        free(part);
+        return 1;
+    }
+
+    // a = a1 * B^m + a0, b = b1 * B^m + b0, with blen > m.
+    size_t m = alen / 2;
+    const uint64_t *a0 = a, *a1 = a + m, *b0 = b, *b1 = b + m;
+    size_t a0len = mag_trim(a0, m), b0len = mag_trim(b0, m);
+    size_t a1len = alen - m, b1len = blen - m;
+    size_t slen = a1len + 1, tlen = (b1len > m ? b1len : m) + 1;
+    uint64_t *scratch = calloc(slen + tlen + slen + tlen, sizeof(uint64_t));
+    if (!scratch)
+        return 0;
+    uint64_t *sa = scratch, *sb = sa + slen, *z1 = sb + tlen;
+
+    // z0 = a0 * b0 fills r[0, 2m) and z2 = a1 * b1 fills r[2m, alen + blen).
+    if (!mag_mul(r, a0, a0len, b0, b0len) || !mag_mul(r + 2 * m, a1, a1len, b1, b1len)) {
+        free(scratch);
+        return 0;
+    }
+    // z1 = (a0 + a1)(b0 + b1) - z0 - z2, then r += z1 * B^m.
+    size_t salen = mag_add(sa, a0, a0len, a1, a1len);
+    size_t sblen = mag_add(sb, b0, b0len, b1, b1len);
+    if (!mag_mul(z1, sa, salen, sb, sblen)) {
+        free(scratch);
+        return 0;
+    }
+    size_t z1len = mag_trim(z1, salen + sblen);
+    z1len = mag_sub(z1, z1, z1len, r, mag_trim(r, 2 * m));
+    z1len = mag_sub(z1, z1, z1len, r + 2 * m, mag_trim(r + 2 * m, alen + blen - 2 * m));
+    mag_add_into(r + m, alen + blen - m, z1, z1len);
+    free(scratch);
+    return 1;
+}
+
+/*
+ * Store the sign and trimmed length of a freshly computed bignum in tmp and
+ * publish it in out, as an int when it fits.
+ */
+static ReturnStatus bignum_finish(Value *tmp, size_t len, int negative, Value *out) {
+    Bignum *r = tmp->as.bignum;
+    r->len = mag_trim(r->limbs, len);
+    r->negative = negative && r->len > 0;
+    if (r->len == 0) {
+        out->type = VALUE_INT;
+        out->as.i = 0;
+    } else if (r->len == 1 && (r->limbs[0] <= INT64_MAX || (negative && r->limbs[0] == (uint64_t)1 << 63))) {
+        out->type = VALUE_INT;
+        out->as.i = negative ? (int64_t)(0 - r->limbs[0]) : (int64_t)r->limbs[0];
+    } else {
+        *out = *tmp;
+    }
+    return RETURN_STATUS_SUCCESS;
+}
+
+/*
+ * Integer value of a decimal literal: an optional sign followed by digits.
+ * Digits are consumed LIMB_DECIMAL_DIGITS at a time.
+ */
+ReturnStatus bignum_parse(Heap *heap, const char *text, size_t len, Value *out) {
+    int negative = len > 0 && text[0] == '-';
+    if (len > 0 && (text[0] == '-' || text[0] == '+')) {
+        text++;
+        len--;
+    }
+    Value tmp;
+    ReturnStatus status = heap_bignum(heap, (len + LIMB_DECIMAL_DIGITS - 1) / LIMB_DECIMAL_DIGITS, &tmp);
+    if (status != RETURN_STATUS_SUCCESS)
+        return status;
+    uint64_t *r = tmp.as.bignum->limbs;
+    size_t rlen = 0;
+    for (size_t i = 0; i < len;) {
+        uint64_t chunk = 0, scale = 1;
+        for (size_t k = 0; k < LIMB_DECIMAL_DIGITS && i < len; k++, i++) {
+            chunk = chunk * 10 + (uint64_t)(text[i] - '0');
+            scale *= 10;
+        }
+        uint64_t carry = chunk;
+        for (size_t j = 0; j < rlen; j++) {
+            uint128_t t = (uint128_t)r[j] * scale + carry;
+            r[j] = (uint64_t)t;
+            carry = (uint64_t)(t >> 64);
+        }
+        if (carry)
+            r[rlen++] = carry;
+    }
+    return bignum_finish(&tmp, rlen, negative, out);
+}
+
+/* a + b, or a - b when negate_b is set. */
+static ReturnStatus bignum_add_signed(Heap *heap, const Value *a, const Value *b, int negate_b, Value *out) {
+    size_t alen = value_len(a), blen = value_len(b);
+    Value tmp;
+    ReturnStatus status = heap_bignum(heap, (alen > blen ? alen : blen) + 1, &tmp);
+    if (status != RETURN_STATUS_SUCCESS)
+        return status;
+    Operand x, y;
+    operand_init(&x, a);
+    operand_init(&y, b);
+    y.negative ^= negate_b;
+    uint64_t *r = tmp.as.bignum->limbs;
+    if (x.negative == y.negative)
+        return bignum_finish(&tmp, mag_add(r, x.limbs, x.len, y.limbs, y.len), x.negative, out);
+    if (mag_cmp(x.limbs, x.len, y.limbs, y.len) >= 0)
+        return bignum_finish(&tmp, mag_sub(r, x.limbs, x.len, y.limbs, y.len), x.negative, out);
+    return bignum_finish(&tmp, mag_sub(r, y.limbs, y.len, x.limbs, x.len), y.negative, out);
+}
+
+ReturnStatus bignum_add(Heap *heap, const Value *a, const Value *b, Value *out) {
+    return bignum_add_signed(heap, a, b, 0, out);
+}
+
+ReturnStatus bignum_sub(Heap *heap, const Value *a, const Value *b, Value *out) {
+    return bignum_add_signed(heap, a, b, 1, out);
+}
+
+ReturnStatus bignum_mul(Heap *heap, const Value *a, const Value *b, Value *out) {
+    size_t alen = value_len(a), blen = value_len(b);
+    Value tmp;
+    ReturnStatus status = heap_bignum(heap, alen + blen, &tmp);
+    if (status != RETURN_STATUS_SUCCESS)
+        return status;
+    Operand x, y;
+    operand_init(&x, a);
+    operand_init(&y, b);
+    if (!mag_mul(tmp.as.bignum->limbs, x.limbs, x.len, y.limbs, y.len)) {
+        fprintf(stderr, "Error: Out of memory multiplying bignums.\n");
+        tmp.as.bignum->len = 0;
+        return RETURN_STATUS_RUNTIME_ERROR;
+    }
+    return bignum_finish(&tmp, x.len + y.len, x.negative != y.negative, out);
+}
+
+/* -1, 0 or 1 as a is less than, equal to or greater than b. */
+int bignum_compare(const Value *a, const Value *b) {
+    if (a->type == VALUE_INT && b->type == VALUE_INT)
+        return (a->as.i > b->as.i) - (a->as.i < b->as.i);
+    Operand x, y;
+    operand_init(&x, a);
+    operand_init(&y, b);
+    if (x.negative != y.negative)
+        return x.negative ? -1 : 1;
+    int c = mag_cmp(x.limbs, x.len, y.limbs, y.len);
+    return x.negative ? -c : c;
+}
+
+/* Write an INT or BIGNUM in decimal, peeling off LIMB_DECIMAL_DIGITS at a time. */
+void bignum_print(const Value *value, FILE *out) {
+    if (value->type == VALUE_INT) {
+        fprintf(out, "%" PRId64, value->as.i);
+        return;
+    }
+    const Bignum *b = value->as.bignum;
+    uint64_t *q = malloc(b->len * sizeof(uint64_t));
+    uint64_t *chunks = malloc((2 * b->len + 1) * sizeof(uint64_t));
+    if (!q || !chunks) {
+        fprintf(out, "#<bignum>");
+        free(q);
+        free(chunks);
+        return;
+    }
+    memcpy(q, b->limbs, b->len * sizeof(uint64_t));
+    size_t qlen = b->len, count = 0;
+    do {
+        uint64_t rem = 0;
+        for (size_t i = qlen; i-- > 0;) {
+            uint128_t cur = ((uint128_t)rem << 64) | q[i];
+            q[i] = (uint64_t)(cur / LIMB_DECIMAL_BASE);
+            rem = (uint64_t)(cur % LIMB_DECIMAL_BASE);
+        }
+        chunks[count++] = rem;
+        qlen = mag_trim(q, qlen);
+    } while (qlen > 0);
+    fprintf(out, "%s%" PRIu64, b->negative ? "-" : "", chunks[count - 1]);
+    for (size_t i = count - 1; i-- > 0;)
+        fprintf(out, "%019" PRIu64, chunks[i]);
+    free(q);
+    free(chunks);
+}
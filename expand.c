@@ -0,0 +1,743 @@
+#include "tau.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Macro expansion: a source-to-source pass run before evaluation. It walks
+ * a program's markers and copies the input lazily, so only the regions it
+ * rewrites cost anything:
+ *   - (define-syntax name (syntax-rules (literal ...) (pattern template) ...))
+ *     registers a macro and is replaced by 'name.
+ *   - A call to a macro is matched against its rules and replaced by the
+ *     instantiated template, itself expanded again. The fully expanded text
+ *     of each call is cached under the call's own text, so a call site that
+ *     is expanded again (the same program run twice, or the same request on
+ *     the server) costs one table lookup. The cache is dropped whole once it
+ *     holds EXPAND_CACHE_MAX bytes, so a stream of distinct calls cannot
+ *     grow it without bound.
+ *   - The syntax-object readers #' #` #, #,@ and long-form (unquote x)
+ *     inside templates become their quote/quasiquote equivalents, and macro
+ *     calls in unquoted code are expanded. eval_template still builds the
+ *     template's value.
+ * Expansion is not hygienic: template symbols are inserted as written.
+ */
+
+#define EXPAND_MAX_DEPTH   256  // Nested macro expansions before giving up
+#define ELLIPSIS_MAX_DEPTH 4    // Nested ... in one pattern
+
+typedef struct {
+    Interp *interp;
+    Buffer *markers;
+    const char *input;
+    Buffer *out;      // char, expanded text
+    size_t copied;    // input[0, copied) is already accounted for in out
+    int depth;        // Enclosing macro expansions
+    int edited;       // Something was rewritten
+} Walk;
+
+/* A pattern variable bound to one datum of the call. */
+typedef struct {
+    const char *name;               // In the macro's source
+    size_t len;
+    size_t idx[ELLIPSIS_MAX_DEPTH]; // Repetition at each enclosing ellipsis
+    size_t bidx, eidx;              // Datum text in the call's input
+} Binding;
+
+/* A pattern variable and the number of ellipses it sits under. */
+typedef struct {
+    const char *name;
+    size_t len;
+    size_t depth;
+} PatternVar;
+
+typedef struct {
+    const Macro *macro;
+    Walk *call;
+    Buffer *bindings;  // Binding
+    Buffer *vars;      // PatternVar
+    size_t idx[ELLIPSIS_MAX_DEPTH];
+} Match;
+
+static ReturnStatus walk_expr(Walk *w, size_t *index);
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static Marker *nth(Buffer *markers, size_t i) {
+    return (Marker *)buffer_nth(markers, i);
+}
+
+static int text_is(const char *input, const Marker *m, const char *s) {
+    size_t len = strlen(s);
+    return m->eidx - m->bidx == len && memcmp(input + m->bidx, s, len) == 0;
+}
+
+static int symbol_is(const char *input, const Marker *m, const char *s) {
+    return m && m->type == MARKER_SYMBOL && text_is(input, m, s);
+}
+
+/* End of the text of the datum starting at marker i. */
+static size_t datum_end(Buffer *markers, size_t i) {
+    return nth(markers, nth(markers, i)->jump - 1)->eidx;
+}
+
+/* Index of the ')' closing the list at form, or SIZE_MAX if it is unclosed. */
+static size_t closing_paren(Buffer *markers, size_t form) {
+    Marker *close = nth(markers, nth(markers, form)->jump - 1);
+    return close->type == MARKER_RPAREN && close->jump == form ? nth(markers, form)->jump - 1 : SIZE_MAX;
+}
+
+static ReturnStatus emit(Buffer *out, const char *text, size_t len) {
+    if (!buffer_extend(out, text, len)) {
+        fprintf(stderr, "Error: Out of memory during macro expansion.\n");
+        return RETURN_STATUS_RUNTIME_ERROR;
+    }
+    return RETURN_STATUS_SUCCESS;
+}
+
+/* Copy the untouched input up to pos. */
+static ReturnStatus copy_to(Walk *w, size_t pos) {
+    ReturnStatus status = emit(w->out, w->input + w->copied, pos - w->copied);
+    w->copied = pos;
+    return status;
+}
+
+/* Replace the input text [bidx, eidx) with text. */
+static ReturnStatus replace(Walk *w, size_t bidx, size_t eidx, const char *text, size_t len) {
+    ReturnStatus status = copy_to(w, bidx);
+    if (status == RETURN_STATUS_SUCCESS)
+        status = emit(w->out, text, len);
+    w->copied = eidx;
+    w->edited = 1;
+    return status;
+}
+
+/*
+ * Expander
+ */
+
+ReturnStatus expander_init(Expander *expander) {
+    memset(expander, 0, sizeof(*expander));
+    expander->macros = buffer_create(sizeof(Macro), 8);
+    expander->expansions = buffer_create(sizeof(char *), 64);
+    if (!expander->macros || !expander->expansions ||
+        symbol_table_init(&expander->cache) != RETURN_STATUS_SUCCESS) {
+        expander_destroy(expander);
+        return RETURN_STATUS_RUNTIME_ERROR;
+    }
+    return RETURN_STATUS_SUCCESS;
+}
+
+static void expander_free_cache(Expander *expander) {
+    if (expander->expansions)
+        for (size_t i = 0; i < expander->expansions->count; i++)
+            free(*(char **)buffer_nth(expander->expansions, i));
+    symbol_table_destroy(&expander->cache);
+}
+
+void expander_destroy(Expander *expander) {
+    if (expander->macros) {
+        for (size_t i = 0; i < expander->macros->count; i++) {
+            Macro *macro = (Macro *)buffer_nth(expander->macros, i);
+            free(macro->source);
+            buffer_destroy(macro->markers);
+        }
+        buffer_destroy(expander->macros);
+    }
+    expander_free_cache(expander);
+    buffer_destroy(expander->expansions);
+    expander->macros = NULL;
+    expander->expansions = NULL;
+}
+
+/*
+ * Drop every cached expansion: a definition may change any of them, and a
+ * full cache is cheaper to refill than to track recency in.
+ */
+static ReturnStatus expander_clear_cache(Expander *expander) {
+    expander_free_cache(expander);
+    buffer_clear(expander->expansions);
+    expander->cache_bytes = 0;
+    expander->generation++;
+    return symbol_table_init(&expander->cache);
+}
+
+static Macro *find_macro(Expander *expander, const char *name, size_t len) {
+    for (size_t i = 0; i < expander->macros->count; i++) {
+        Macro *macro = (Macro *)buffer_nth(expander->macros, i);
+        if (macro->name_len == len && memcmp(macro->name, name, len) == 0)
+            return macro;
+    }
+    return NULL;
+}
+
+/*
+ * define-syntax
+ */
+
+static int define_syntax_error(Macro *macro, const char *what) {
+    fprintf(stderr, "Error: Malformed define-syntax: %s.\n", what);
+    free(macro->source);
+    buffer_destroy(macro->markers);
+    return 0;
+}
+
+/* Parse the define-syntax form in macro->source. Frees the macro on failure. */
+static int parse_macro(Macro *macro) {
+    Buffer *markers = macro->markers;
+    const char *src = macro->source;
+    if (read_markers(src, markers) != RETURN_STATUS_SUCCESS)
+        return define_syntax_error(macro, "unreadable");
+    Marker *name = nth(markers, 2), *rules = nth(markers, 3), *literals = nth(markers, 5);
+    if (!name || name->type != MARKER_SYMBOL)
+        return define_syntax_error(macro, "expected a keyword");
+    if (rules->type != MARKER_LPAREN || !symbol_is(src, nth(markers, 4), "syntax-rules"))
+        return define_syntax_error(macro, "expected (syntax-rules ...)");
+    if (!literals || literals->type != MARKER_LPAREN || closing_paren(markers, 5) == SIZE_MAX)
+        return define_syntax_error(macro, "expected a literals list");
+    for (size_t i = 6; i < literals->jump - 1; i++)
+        if (nth(markers, i)->type != MARKER_SYMBOL)
+            return define_syntax_error(macro, "literals must be symbols");
+    macro->name = src + name->bidx;
+    macro->name_len = name->eidx - name->bidx;
+    macro->literals = 5;
+    macro->rules = literals->jump;
+    macro->rules_end = closing_paren(markers, 3);
+    if (macro->rules_end == SIZE_MAX || rules->jump + 1 != markers->count)
+        return define_syntax_error(macro, "unbalanced form");
+    for (size_t r = macro->rules; r < macro->rules_end; r = nth(markers, r)->jump) {
+        size_t rule_end = closing_paren(markers, r);
+        if (rule_end == SIZE_MAX || nth(markers, r + 1)->type != MARKER_LPAREN ||
+            nth(markers, r + 2)->type == MARKER_RPAREN || nth(markers, r + 1)->jump >= rule_end ||
+            nth(markers, nth(markers, r + 1)->jump)->jump != rule_end)
+            return define_syntax_error(macro, "each rule must be (pattern template)");
+    }
+    return 1;
+}
+
+static ReturnStatus define_syntax(Walk *w, size_t form, size_t end) {
+    Expander *expander = &w->interp->expander;
+    size_t bidx = nth(w->markers, form)->bidx;
+    Macro macro = { .markers = buffer_create(sizeof(Marker), 64) };
+    macro.source = malloc(end - bidx + 1);
+    if (!macro.source || !macro.markers) {
+        free(macro.source);
+        buffer_destroy(macro.markers);
+        return RETURN_STATUS_RUNTIME_ERROR;
+    }
+    memcpy(macro.source, w->input + bidx, end - bidx);
+    macro.source[end - bidx] = '\0';
+    if (!parse_macro(&macro))
+        return RETURN_STATUS_RUNTIME_ERROR;
+
+    Macro *old = find_macro(expander, macro.name, macro.name_len);
+    if (old && strcmp(old->source, macro.source) == 0) {
+        // Redefined as before, as a batch that carries its own macros does: keep the cache.
+        free(macro.source);
+        buffer_destroy(macro.markers);
+        return RETURN_STATUS_SUCCESS;
+    }
+    if (old) {
+        free(old->source);
+        buffer_destroy(old->markers);
+        *old = macro;
+    } else if (!buffer_push(expander->macros, &macro)) {
+        free(macro.source);
+        buffer_destroy(macro.markers);
+        return RETURN_STATUS_RUNTIME_ERROR;
+    }
+    return expander_clear_cache(expander);
+}
+
+/*
+ * Pattern matching
+ */
+
+static int is_literal(const Macro *macro, const Marker *m) {
+    Marker *list = nth(macro->markers, macro->literals);
+    for (size_t i = macro->literals + 1; i < list->jump - 1; i++) {
+        Marker *lit = nth(macro->markers, i);
+        if (lit->eidx - lit->bidx == m->eidx - m->bidx &&
+            memcmp(macro->source + lit->bidx, macro->source + m->bidx, m->eidx - m->bidx) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+static int is_ellipsis(const Macro *macro, size_t i) {
+    return symbol_is(macro->source, nth(macro->markers, i), "...");
+}
+
+static int is_pattern_var(const Macro *macro, const Marker *m) {
+    return m->type == MARKER_SYMBOL && !text_is(macro->source, m, "_") &&
+           !text_is(macro->source, m, "...") && !is_literal(macro, m);
+}
+
+static int match(Match *mt, size_t p, size_t f, size_t depth);
+
+/* Match the pattern elements [p, pend) against the call's data [f, fend). */
+static int match_list(Match *mt, size_t p, size_t pend, size_t f, size_t fend, size_t depth) {
+    Buffer *pm = mt->macro->markers, *fm = mt->call->markers;
+    while (p < pend) {
+        size_t next = nth(pm, p)->jump;
+        if (next < pend && is_ellipsis(mt->macro, next)) {
+            if (depth >= ELLIPSIS_MAX_DEPTH)
+                return 0;
+            size_t after = next + 1, needed = 0, available = 0;
+            for (size_t i = after; i < pend; i = nth(pm, i)->jump)
+                needed++;
+            for (size_t i = f; i < fend; i = nth(fm, i)->jump)
+                available++;
+            if (available < needed)
+                return 0;
+            for (size_t k = 0; k < available - needed; k++, f = nth(fm, f)->jump) {
+                mt->idx[depth] = k;
+                if (!match(mt, p, f, depth + 1))
+                    return 0;
+            }
+            p = after;
+            continue;
+        }
+        if (f >= fend || !match(mt, p, f, depth))
+            return 0;
+        p = next;
+        f = nth(fm, f)->jump;
+    }
+    return f == fend;
+}
+
+static int match(Match *mt, size_t p, size_t f, size_t depth) {
+    const Macro *macro = mt->macro;
+    Marker *pm = nth(macro->markers, p), *fm = nth(mt->call->markers, f);
+    const char *input = mt->call->input;
+    if (pm->type == MARKER_SYMBOL) {
+        if (text_is(macro->source, pm, "_"))
+            return 1;
+        if (is_literal(macro, pm))
+            return fm->type == MARKER_SYMBOL && fm->eidx - fm->bidx == pm->eidx - pm->bidx &&
+                   memcmp(input + fm->bidx, macro->source + pm->bidx, pm->eidx - pm->bidx) == 0;
+        Binding b = { macro->source + pm->bidx, pm->eidx - pm->bidx, {0},
+                      fm->bidx, datum_end(mt->call->markers, f) };
+        memcpy(b.idx, mt->idx, depth * sizeof(size_t));
+        return buffer_push(mt->bindings, &b);
+    }
+    if (pm->type == MARKER_LPAREN) {
+        if (fm->type != MARKER_LPAREN)
+            return 0;
+        return match_list(mt, p + 1, pm->jump - 1, f + 1, fm->jump - 1, depth);
+    }
+    if (pm->jump != p + 1) {
+        // Reader prefix such as 'x: the call must use the same one.
+        return fm->type == pm->type && match(mt, p + 1, f + 1, depth);
+    }
+    return fm->type == pm->type && fm->eidx - fm->bidx == pm->eidx - pm->bidx &&
+           memcmp(input + fm->bidx, macro->source + pm->bidx, pm->eidx - pm->bidx) == 0;
+}
+
+static int collect_vars(Match *mt, size_t p, size_t depth);
+
+/* Record the pattern variables among the elements [p, pend). */
+static int collect_list(Match *mt, size_t p, size_t pend, size_t depth) {
+    while (p < pend) {
+        size_t next = nth(mt->macro->markers, p)->jump;
+        int repeated = next < pend && is_ellipsis(mt->macro, next);
+        if (!collect_vars(mt, p, depth + repeated))
+            return 0;
+        p = repeated ? next + 1 : next;
+    }
+    return 1;
+}
+
+static int collect_vars(Match *mt, size_t p, size_t depth) {
+    const Macro *macro = mt->macro;
+    Marker *pm = nth(macro->markers, p);
+    if (pm->type == MARKER_LPAREN)
+        return collect_list(mt, p + 1, pm->jump - 1, depth);
+    if (pm->jump != p + 1)
+        return collect_vars(mt, p + 1, depth);
+    if (!is_pattern_var(macro, pm))
+        return 1;
+    PatternVar var = { macro->source + pm->bidx, pm->eidx - pm->bidx, depth };
+    return buffer_push(mt->vars, &var);
+}
+
+/*
+ * Template instantiation
+ */
+
+static PatternVar *find_var(Match *mt, const Marker *m) {
+    const char *name = mt->macro->source + m->bidx;
+    size_t len = m->eidx - m->bidx;
+    for (size_t i = 0; i < mt->vars->count; i++) {
+        PatternVar *var = (PatternVar *)buffer_nth(mt->vars, i);
+        if (var->len == len && memcmp(var->name, name, len) == 0)
+            return var;
+    }
+    return NULL;
+}
+
+static Binding *find_binding(Match *mt, const PatternVar *var) {
+    for (size_t i = 0; i < mt->bindings->count; i++) {
+        Binding *b = (Binding *)buffer_nth(mt->bindings, i);
+        if (b->len == var->len && memcmp(b->name, var->name, var->len) == 0 &&
+            memcmp(b->idx, mt->idx, var->depth * sizeof(size_t)) == 0)
+            return b;
+    }
+    return NULL;
+}
+
+/*
+ * Repetitions of the template at t under an ellipsis at depth, taken from
+ * the first variable inside it that was matched under a deeper ellipsis.
+ * Returns 0 if there is no such variable.
+ */
+static int ellipsis_count(Match *mt, size_t t, size_t depth, size_t *count) {
+    for (size_t i = t; i < nth(mt->macro->markers, t)->jump; i++) {
+        Marker *tm = nth(mt->macro->markers, i);
+        PatternVar *var = tm->type == MARKER_SYMBOL ? find_var(mt, tm) : NULL;
+        if (!var || var->depth <= depth)
+            continue;
+        *count = 0;
+        for (size_t k = 0; k < mt->bindings->count; k++) {
+            Binding *b = (Binding *)buffer_nth(mt->bindings, k);
+            if (b->len == var->len && memcmp(b->name, var->name, var->len) == 0 &&
+                memcmp(b->idx, mt->idx, depth * sizeof(size_t)) == 0 && b->idx[depth] + 1 > *count)
+                *count = b->idx[depth] + 1;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+static ReturnStatus instantiate(Match *mt, size_t t, size_t depth, Buffer *out) {
+    const Macro *macro = mt->macro;
+    Marker *tm = nth(macro->markers, t);
+    ReturnStatus status;
+    if (tm->type == MARKER_SYMBOL) {
+        PatternVar *var = find_var(mt, tm);
+        if (!var)
+            return emit(out, macro->source + tm->bidx, tm->eidx - tm->bidx);
+        Binding *b = var->depth <= depth ? find_binding(mt, var) : NULL;
+        if (!b) {
+            fprintf(stderr, "Error: Pattern variable '%.*s' used at the wrong ellipsis depth in '%.*s'.\n",
+                    (int)var->len, var->name, (int)macro->name_len, macro->name);
+            return RETURN_STATUS_RUNTIME_ERROR;
+        }
+        return emit(out, mt->call->input + b->bidx, b->eidx - b->bidx);
+    }
+    if (tm->type == MARKER_LPAREN) {
+        if ((status = emit(out, "(", 1)) != RETURN_STATUS_SUCCESS)
+            return status;
+        for (size_t i = t + 1; i < tm->jump - 1;) {
+            size_t next = nth(macro->markers, i)->jump;
+            if (i > t + 1 && (status = emit(out, " ", 1)) != RETURN_STATUS_SUCCESS)
+                return status;
+            if (next < tm->jump - 1 && is_ellipsis(macro, next)) {
+                size_t count;
+                if (depth >= ELLIPSIS_MAX_DEPTH || !ellipsis_count(mt, i, depth, &count)) {
+                    fprintf(stderr, "Error: '...' in the template of '%.*s' follows no repeated pattern variable.\n",
+                            (int)macro->name_len, macro->name);
+                    return RETURN_STATUS_RUNTIME_ERROR;
+                }
+                for (size_t k = 0; k < count; k++) {
+                    mt->idx[depth] = k;
+                    if ((k > 0 && (status = emit(out, " ", 1)) != RETURN_STATUS_SUCCESS) ||
+                        (status = instantiate(mt, i, depth + 1, out)) != RETURN_STATUS_SUCCESS)
+                        return status;
+                }
+                i = next + 1;
+                continue;
+            }
+            if ((status = instantiate(mt, i, depth, out)) != RETURN_STATUS_SUCCESS)
+                return status;
+            i = next;
+        }
+        return emit(out, ")", 1);
+    }
+    if ((status = emit(out, macro->source + tm->bidx, tm->eidx - tm->bidx)) != RETURN_STATUS_SUCCESS)
+        return status;
+    return tm->jump != t + 1 ? instantiate(mt, t + 1, depth, out) : RETURN_STATUS_SUCCESS;
+}
+
+/*
+ * Macro calls
+ */
+
+/* Expand text completely into out, with depth enclosing expansions. */
+static ReturnStatus expand_text(Interp *interp, const char *text, int depth, Buffer *out) {
+    Buffer *markers __attribute__ ((__cleanup__(buffer_cleanup))) = buffer_create(sizeof(Marker), 64);
+    if (!markers)
+        return RETURN_STATUS_RUNTIME_ERROR;
+    ReturnStatus status = read_markers(text, markers);
+    if (status != RETURN_STATUS_SUCCESS)
+        return status;
+    Walk w = { interp, markers, text, out, 0, depth, 0 };
+    for (size_t i = 0; i < markers->count;)
+        if ((status = walk_expr(&w, &i)) != RETURN_STATUS_SUCCESS)
+            return status;
+    return copy_to(&w, strlen(text));
+}
+
+/* Rewrite the call at form with the first rule of macro that matches it. */
+static ReturnStatus expand_call(Walk *w, const Macro *macro, size_t form, Buffer *out) {
+    Buffer *bindings __attribute__ ((__cleanup__(buffer_cleanup))) = buffer_create(sizeof(Binding), 16);
+    Buffer *vars __attribute__ ((__cleanup__(buffer_cleanup))) = buffer_create(sizeof(PatternVar), 16);
+    Buffer *text __attribute__ ((__cleanup__(buffer_cleanup))) = buffer_create(sizeof(char), 256);
+    if (!bindings || !vars || !text)
+        return RETURN_STATUS_RUNTIME_ERROR;
+    Match mt = { macro, w, bindings, vars, {0} };
+    Buffer *pm = macro->markers;
+    for (size_t r = macro->rules; r < macro->rules_end; r = nth(pm, r)->jump) {
+        size_t pattern = r + 1, keyword = r + 2;
+        buffer_clear(bindings);
+        buffer_clear(vars);
+        if (!match_list(&mt, nth(pm, keyword)->jump, nth(pm, pattern)->jump - 1,
+                        form + 2, nth(w->markers, form)->jump - 1, 0))
+            continue;
+        if (!collect_list(&mt, nth(pm, keyword)->jump, nth(pm, pattern)->jump - 1, 0))
+            return RETURN_STATUS_RUNTIME_ERROR;
+        ReturnStatus status = instantiate(&mt, nth(pm, pattern)->jump, 0, text);
+        if (status != RETURN_STATUS_SUCCESS || (status = emit(text, "", 1)) != RETURN_STATUS_SUCCESS)
+            return status;
+        return expand_text(w->interp, text->data, w->depth + 1, out);
+    }
+    size_t bidx = nth(w->markers, form)->bidx;
+    fprintf(stderr, "Error: No syntax-rules pattern of '%.*s' matches %.*s\n",
+            (int)macro->name_len, macro->name,
+            (int)(datum_end(w->markers, form) - bidx), w->input + bidx);
+    return RETURN_STATUS_RUNTIME_ERROR;
+}
+
+/*
+ * Replace the call at form with its expansion, from the cache when this
+ * exact call text was expanded before under the current macros.
+ */
+static ReturnStatus cached_call(Walk *w, const Macro *macro, size_t form, size_t end) {
+    Expander *expander = &w->interp->expander;
+    size_t bidx = nth(w->markers, form)->bidx;
+    ReturnStatus status;
+    expander->stats.calls++;
+    if (w->depth >= EXPAND_MAX_DEPTH) {
+        fprintf(stderr, "Error: Macro expansion of '%.*s' nested more than %d deep.\n",
+                (int)macro->name_len, macro->name, EXPAND_MAX_DEPTH);
+        return RETURN_STATUS_RUNTIME_ERROR;
+    }
+
+    // Clearing bumps the generation, so enclosing calls will not store into stale slots.
+    if (expander->cache_bytes > EXPAND_CACHE_MAX && (status = expander_clear_cache(expander)) != RETURN_STATUS_SUCCESS)
+        return status;
+    size_t id;
+    if ((status = symbol_intern(&expander->cache, w->input + bidx, end - bidx, &id)) != RETURN_STATUS_SUCCESS)
+        return status;
+    if (id < expander->expansions->count) {
+        const char *cached = *(char **)buffer_nth(expander->expansions, id);
+        if (cached) {
+            expander->stats.cache_hits++;
+            return replace(w, bidx, end, cached, strlen(cached));
+        }
+    } else {
+        // Claim the slot now; nested calls intern and store their own.
+        char *none = NULL;
+        if (!buffer_push(expander->expansions, &none))
+            return RETURN_STATUS_RUNTIME_ERROR;
+        expander->cache_bytes += end - bidx;
+    }
+
+    Buffer *text __attribute__ ((__cleanup__(buffer_cleanup))) = buffer_create(sizeof(char), 256);
+    if (!text)
+        return RETURN_STATUS_RUNTIME_ERROR;
+    size_t generation = expander->generation;
+    // Pad with spaces so the expansion cannot fuse with neighbouring tokens.
+    if ((status = emit(text, " ", 1)) != RETURN_STATUS_SUCCESS ||
+        (status = expand_call(w, macro, form, text)) != RETURN_STATUS_SUCCESS ||
+        (status = emit(text, " ", 1)) != RETURN_STATUS_SUCCESS)
+        return status;
+    // A definition or a full cache inside the expansion drops the cache, and id with it.
+    if (generation == expander->generation) {
+        char *copy = malloc(text->count + 1);
+        if (copy) {
+            memcpy(copy, text->data, text->count);
+            copy[text->count] = '\0';
+            *(char **)buffer_nth(expander->expansions, id) = copy;
+            expander->cache_bytes += text->count;
+        }
+    }
+    return replace(w, bidx, end, text->data, text->count);
+}
+
+/*
+ * Walk
+ */
+
+/* Rewrite a syntax reader prefix to the quote or quasiquote one. */
+static ReturnStatus respell_prefix(Walk *w, const Marker *m) {
+    switch (m->type) {
+        case MARKER_SYNTAX:            return replace(w, m->bidx, m->eidx, "'", 1);
+        case MARKER_QUASI_SYNTAX:      return replace(w, m->bidx, m->eidx, "`", 1);
+        case MARKER_UNSYNTAX:          return replace(w, m->bidx, m->eidx, ",", 1);
+        case MARKER_UNSYNTAX_SPLICING: return replace(w, m->bidx, m->eidx, ",@", 2);
+        default:                       return RETURN_STATUS_SUCCESS;
+    }
+}
+
+/* The reader prefix a one-argument template form such as (unquote x) stands for. */
+static const char *long_form_prefix(Walk *w, size_t form) {
+    static const struct { const char *name, *prefix; } forms[] = {
+        { "quasiquote", "`" }, { "unquote", "," }, { "unquote-splicing", ",@" },
+        { "quasisyntax", "`" }, { "unsyntax", "," }, { "unsyntax-splicing", ",@" },
+    };
+    Marker *head = nth(w->markers, form + 1);
+    if (!head || head->type != MARKER_SYMBOL || head->jump >= w->markers->count ||
+        nth(w->markers, head->jump)->jump != nth(w->markers, form)->jump - 1 ||
+        closing_paren(w->markers, form) == SIZE_MAX)
+        return NULL;
+    for (size_t i = 0; i < sizeof(forms) / sizeof(forms[0]); i++)
+        if (text_is(w->input, head, forms[i].name))
+            return forms[i].prefix;
+    return NULL;
+}
+
+/*
+ * Walk the quasiquote template at *index with depth enclosing quasiquotes.
+ * Unquoted code at depth 0 is walked as an expression.
+ */
+static ReturnStatus walk_template(Walk *w, size_t *index, int depth) {
+    Marker *m = nth(w->markers, *index);
+    ReturnStatus status;
+    if (m->type == MARKER_LPAREN) {
+        const char *prefix = long_form_prefix(w, *index);
+        if (prefix) {
+            // (unquote x) -> ,x: drop "(unquote " and the closing ')'.
+            size_t arg = *index + 2, close = m->jump - 1;
+            if ((status = replace(w, m->bidx, nth(w->markers, arg)->bidx, prefix, strlen(prefix))) != RETURN_STATUS_SUCCESS)
+                return status;
+            int inner = depth + (*prefix == '`' ? 1 : -1);
+            status = inner == 0 ? walk_expr(w, &arg) : walk_template(w, &arg, inner);
+            if (status != RETURN_STATUS_SUCCESS ||
+                (status = replace(w, nth(w->markers, close)->bidx, nth(w->markers, close)->eidx, "", 0)) != RETURN_STATUS_SUCCESS)
+                return status;
+            *index = m->jump;
+            return RETURN_STATUS_SUCCESS;
+        }
+        size_t i = *index + 1;
+        while (i < w->markers->count && nth(w->markers, i)->type != MARKER_RPAREN)
+            if ((status = walk_template(w, &i, depth)) != RETURN_STATUS_SUCCESS)
+                return status;
+        *index = m->jump;
+        return RETURN_STATUS_SUCCESS;
+    }
+    if (m->jump == *index + 1 || m->type == MARKER_RPAREN) {
+        (*index)++;
+        return RETURN_STATUS_SUCCESS;
+    }
+    int inner = depth;
+    if (m->type == MARKER_QUASI_QUOTE || m->type == MARKER_QUASI_SYNTAX)
+        inner++;
+    else if (m->type != MARKER_QUOTE && m->type != MARKER_SYNTAX)
+        inner--;
+    if ((status = respell_prefix(w, m)) != RETURN_STATUS_SUCCESS)
+        return status;
+    size_t i = *index + 1;
+    *index = m->jump;
+    if (i >= w->markers->count)
+        return RETURN_STATUS_SUCCESS;
+    return inner == 0 ? walk_expr(w, &i) : walk_template(w, &i, inner);
+}
+
+static ReturnStatus walk_form(Walk *w, size_t *index) {
+    size_t form = *index, close = closing_paren(w->markers, form);
+    Marker *head = nth(w->markers, form + 1);
+    ReturnStatus status;
+    if (close != SIZE_MAX && head->type == MARKER_SYMBOL) {
+        const char *input = w->input;
+        size_t end = nth(w->markers, close)->eidx;
+        *index = close + 1;
+        if (text_is(input, head, "quote") || text_is(input, head, "struct") ||
+            text_is(input, head, "sizeof") || text_is(input, head, "offsetof"))
+            return RETURN_STATUS_SUCCESS;
+        if (text_is(input, head, "syntax"))
+            return replace(w, head->bidx, head->eidx, "quote", 5);
+        if (text_is(input, head, "quasiquote") || text_is(input, head, "quasisyntax")) {
+            size_t arg = form + 2;
+            w->interp->expander.stats.templates++;
+            if (text_is(input, head, "quasisyntax") &&
+                (status = replace(w, head->bidx, head->eidx, "quasiquote", 10)) != RETURN_STATUS_SUCCESS)
+                return status;
+            return arg < close ? walk_template(w, &arg, 1) : RETURN_STATUS_SUCCESS;
+        }
+        if (text_is(input, head, "define-syntax")) {
+            Marker *name = nth(w->markers, form + 2);
+            if ((status = define_syntax(w, form, end)) != RETURN_STATUS_SUCCESS ||
+                (status = replace(w, nth(w->markers, form)->bidx, end, "'", 1)) != RETURN_STATUS_SUCCESS)
+                return status;
+            return emit(w->out, input + name->bidx, name->eidx - name->bidx);
+        }
+        Macro *macro = find_macro(&w->interp->expander, input + head->bidx, head->eidx - head->bidx);
+        if (macro)
+            return cached_call(w, macro, form, end);
+    }
+    size_t i = form + 1;
+    while (i < w->markers->count && nth(w->markers, i)->type != MARKER_RPAREN)
+        if ((status = walk_expr(w, &i)) != RETURN_STATUS_SUCCESS)
+            return status;
+    *index = i + 1;
+    return RETURN_STATUS_SUCCESS;
+}
+
+/* Walk the expression at *index, rewriting it in place where needed. */
+static ReturnStatus walk_expr(Walk *w, size_t *index) {
+    Marker *m = nth(w->markers, *index);
+    size_t i = *index + 1;
+    switch (m->type) {
+        case MARKER_LPAREN:
+            return walk_form(w, index);
+        case MARKER_QUOTE:
+            *index = m->jump;
+            return RETURN_STATUS_SUCCESS;
+        case MARKER_SYNTAX:
+            *index = m->jump;
+            return respell_prefix(w, m);
+        case MARKER_QUASI_QUOTE:
+        case MARKER_QUASI_SYNTAX: {
+            ReturnStatus status = respell_prefix(w, m);
+            w->interp->expander.stats.templates++;
+            *index = m->jump;
+            return status != RETURN_STATUS_SUCCESS || i >= w->markers->count ? status : walk_template(w, &i, 1);
+        }
+        default:
+            // Atoms, a stray ')' and unquotes outside a template are left to the evaluator.
+            *index = m->type == MARKER_RPAREN ? i : m->jump;
+            return RETURN_STATUS_SUCCESS;
+    }
+}
+
+/*
+ * Expand the program in markers/input. If anything was rewritten, text
+ * receives the expanded source (NUL-terminated) and expanded its markers;
+ * otherwise text is left empty and the original program should be
+ * evaluated as is.
+ */
+ReturnStatus interp_expand(Interp *interp, Buffer *markers, const char *input, Buffer *text, Buffer *expanded) {
+    uint64_t start = monotonic_ns();
+    buffer_clear(text);
+    Walk w = { interp, markers, input, text, 0, 0, 0 };
+    ReturnStatus status = RETURN_STATUS_SUCCESS;
+    for (size_t i = 0; i < markers->count && status == RETURN_STATUS_SUCCESS;)
+        status = walk_expr(&w, &i);
+    if (status == RETURN_STATUS_SUCCESS && w.edited) {
+        // Something was rewritten: finish the copy and lex the result.
+        if ((status = copy_to(&w, strlen(input))) == RETURN_STATUS_SUCCESS &&
+            (status = emit(text, "", 1)) == RETURN_STATUS_SUCCESS) {
+            buffer_clear(expanded);
+            status = read_markers(text->data, expanded);
+        }
+    }
+    if (status != RETURN_STATUS_SUCCESS)
+        buffer_clear(text);
+    interp->expander.stats.ns += monotonic_ns() - start;
+    return status;
+}
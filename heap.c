@@ -0,0 +1,219 @@
+#include "tau.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+ReturnStatus heap_init(Heap *heap, size_t semispace_size) {
+    memset(heap, 0, sizeof(*heap));
+    if (semispace_size < sizeof(Cons))
+        semispace_size = sizeof(Cons);
+    semispace_size -= semispace_size % sizeof(Cons);
+
+    heap->space = malloc(semispace_size);
+    heap->reserve = malloc(semispace_size);
+    heap->roots = buffer_create(sizeof(Value *), 64);
+    if (!heap->space || !heap->reserve || !heap->roots) {
+        heap_destroy(heap);
+        return RETURN_STATUS_RUNTIME_ERROR;
+    }
+    heap->free = heap->space;
+    heap->limit = heap->space + semispace_size;
+    heap->semispace_size = semispace_size;
+    heap->stats.created_ns = monotonic_ns();
+    return RETURN_STATUS_SUCCESS;
+}
+
+void heap_destroy(Heap *heap) {
+    free(heap->space);
+    free(heap->reserve);
+    buffer_destroy(heap->roots);
+    memset(heap, 0, sizeof(*heap));
+}
+
+/*
+ * Register a Value slot as a root. Pair every push with a heap_root_restore
+ * to the count recorded before it. Returns 1 on success and 0 on failure.
+ */
+int heap_root_push(Heap *heap, Value *slot) {
+    return buffer_push(heap->roots, &slot);
+}
+
+void heap_root_restore(Heap *heap, size_t mark) {
+    heap->roots->count = mark;
+}
+
+/* Heap footprint of a bignum with len limbs; every object is a whole number of Cons. */
+static size_t bignum_bytes(size_t len) {
+    size_t bytes = sizeof(Bignum) + len * sizeof(uint64_t);
+    return (bytes + sizeof(Cons) - 1) / sizeof(Cons) * sizeof(Cons);
+}
+
+/* Copy the object a slot refers to into to-space (once) and update the slot. */
+static void forward(Heap *heap, Value *v) {
+    if (v->type == VALUE_CONS) {
+        Cons *old = v->as.cons;
+        if (old->car.type == VALUE_FORWARD) {
+            v->as.cons = old->car.as.cons;
+            return;
+        }
+        Cons *copy = (Cons *)heap->free;
+        heap->free += sizeof(Cons);
+        *copy = *old;
+        old->car.type = VALUE_FORWARD;
+        old->car.as.cons = copy;
+        v->as.cons = copy;
+    } else if (v->type == VALUE_BIGNUM) {
+        Bignum *old = v->as.bignum;
+        if (old->header.type == VALUE_FORWARD) {
+            v->as.bignum = old->header.as.bignum;
+            return;
+        }
+        // Only the limbs in use are copied, so over-allocated results shrink here.
+        size_t bytes = bignum_bytes(old->len);
+        Bignum *copy = (Bignum *)heap->free;
+        heap->free += bytes;
+        memcpy(copy, old, sizeof(Bignum) + old->len * sizeof(uint64_t));
+        old->header.type = VALUE_FORWARD;
+        old->header.as.bignum = copy;
+        v->as.bignum = copy;
+    }
+}
+
+/*
+ * Cheney scan: evacuate everything reachable from the roots into `to`,
+ * which becomes the allocation space. The old space becomes the reserve.
+ * Returns the number of bytes copied.
+ */
+static size_t evacuate(Heap *heap, char *to, size_t to_size) {
+    char *from = heap->space;
+    heap->free = to;
+    heap->limit = to + to_size;
+
+    for (size_t i = 0; i < heap->roots->count; i++)
+        forward(heap, *(Value **)buffer_nth(heap->roots, i));
+    char *scan = to;
+    while (scan < heap->free) {
+        if (((Value *)scan)->type == VALUE_HEADER) {
+            scan += bignum_bytes(((Bignum *)scan)->len);  // Limbs hold no references.
+            continue;
+        }
+        Cons *c = (Cons *)scan;
+        forward(heap, &c->car);
+        forward(heap, &c->cdr);
+        scan += sizeof(Cons);
+    }
+
+    heap->space = to;
+    heap->reserve = from;
+    return (size_t)(heap->free - to);
+}
+
+/*
+ * Collect garbage, leaving at least min_free bytes available. The semispaces
+ * double whenever live data fills more than half of one, which keeps the
+ * amortized copying cost per allocation constant.
+ */
+ReturnStatus heap_collect(Heap *heap, size_t min_free) {
+    uint64_t start = monotonic_ns();
+    size_t live = evacuate(heap, heap->reserve, heap->semispace_size);
+    heap->stats.bytes_copied += live;
+
+    ReturnStatus status = RETURN_STATUS_SUCCESS;
+    if (live * 2 > heap->semispace_size || (size_t)(heap->limit - heap->free) < min_free) {
+        size_t new_size = heap->semispace_size * 2;
+        while (new_size < live * 2 + min_free)
+            new_size *= 2;
+        char *space = malloc(new_size);
+        char *reserve = malloc(new_size);
+        if (space && reserve) {
+            char *stale = heap->reserve;
+            heap->stats.bytes_copied += evacuate(heap, space, new_size);
+            free(stale);
+            free(heap->reserve);
+            heap->reserve = reserve;
+            heap->semispace_size = new_size;
+        } else {
+            free(space);
+            free(reserve);
+            if ((size_t)(heap->limit - heap->free) < min_free)
+                status = RETURN_STATUS_RUNTIME_ERROR;
+        }
+    }
+
+    uint64_t pause = monotonic_ns() - start;
+    heap->stats.collections++;
+    heap->stats.pause_ns_total += pause;
+    if (pause > heap->stats.pause_ns_max)
+        heap->stats.pause_ns_max = pause;
+    return status;
+}
+
+/* Reserve bytes in the current semispace, collecting first if they do not fit. */
+static void *heap_alloc(Heap *heap, size_t bytes) {
+    if ((size_t)(heap->limit - heap->free) < bytes &&
+        heap_collect(heap, bytes) != RETURN_STATUS_SUCCESS)
+        return NULL;
+    void *p = heap->free;
+    heap->free += bytes;
+    heap->stats.bytes_allocated += bytes;
+    return p;
+}
+
+/*
+ * Allocate a cons cell. car and cdr are read after any collection the
+ * allocation triggers, so heap values passed here must be in root slots.
+ * out may alias car or cdr.
+ */
+ReturnStatus heap_cons(Heap *heap, const Value *car, const Value *cdr, Value *out) {
+    Cons *c = heap_alloc(heap, sizeof(Cons));
+    if (!c)
+        return RETURN_STATUS_RUNTIME_ERROR;
+    c->car = *car;
+    c->cdr = *cdr;
+    out->type = VALUE_CONS;
+    out->as.cons = c;
+    heap->stats.cons_allocated++;
+    return RETURN_STATUS_SUCCESS;
+}
+
+/*
+ * Allocate a bignum with room for len limbs, all zero. The caller fills in
+ * the limbs and sign and must set len to the limbs actually used before the
+ * next allocation.
+ */
+ReturnStatus heap_bignum(Heap *heap, size_t len, Value *out) {
+    size_t bytes = bignum_bytes(len);
+    Bignum *b = heap_alloc(heap, bytes);
+    if (!b)
+        return RETURN_STATUS_RUNTIME_ERROR;
+    memset(b, 0, bytes);
+    b->header.type = VALUE_HEADER;
+    b->len = len;
+    out->type = VALUE_BIGNUM;
+    out->as.bignum = b;
+    heap->stats.bignums_allocated++;
+    return RETURN_STATUS_SUCCESS;
+}
+
+void heap_print_stats(const Heap *heap) {
+    const HeapStats *s = &heap->stats;
+    double wall_ms = (monotonic_ns() - s->created_ns) / 1e6;
+    double pause_ms = s->pause_ns_total / 1e6;
+    printf("GC: %zu collections, pause total %.3f ms, max %.3f ms, avg %.3f ms\n",
+           s->collections, pause_ms, s->pause_ns_max / 1e6,
+           s->collections ? pause_ms / s->collections : 0.0);
+    printf("GC: %zu conses, %zu bignums, %zu bytes allocated, %zu bytes copied, semispace %zu bytes\n",
+           s->cons_allocated, s->bignums_allocated, s->bytes_allocated, s->bytes_copied,
+           heap->semispace_size);
+    printf("GC: %.1f%% of %.3f ms in collection, %.1f MB/s allocated\n",
+           wall_ms > 0 ? 100.0 * pause_ms / wall_ms : 0.0, wall_ms,
+           wall_ms > 0 ? s->bytes_allocated / (wall_ms * 1e3) : 0.0);
+}
@@ -0,0 +1,315 @@
+#include "tau.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+/*
+ * On-disk layout (all sections 8-byte aligned, all offsets from file start):
+ *
+ *   ImageHeader
+ *   Marker      markers[marker_count]    -- exactly the in-memory Marker layout
+ *   int64_t     literals[marker_count]
+ *   ImageString symbols[symbol_count]
+ *   ImageString strings[string_count]    -- string literals, escapes decoded
+ *   char        pool[pool_size]          -- bytes of both tables, NUL-terminated
+ *
+ * image_open checks the header, the section bounds, the two string tables
+ * and every marker, so that a corrupt image whose source hash still
+ * matches is rejected rather than read out of bounds.
+ */
+static const char IMAGE_MAGIC[8] = { 'T', 'A', 'U', 'I', 'M', 'G', '\0', '\0' };
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t marker_size;     // sizeof(Marker) of the writer
+    uint64_t source_hash;
+    uint64_t source_len;
+    uint64_t marker_count;
+    uint64_t markers_offset;
+    uint64_t literals_offset;
+    uint64_t symbol_count;
+    uint64_t symbols_offset;
+    uint64_t string_count;
+    uint64_t strings_offset;
+    uint64_t pool_offset;
+    uint64_t pool_size;
+    uint64_t total_size;
+} ImageHeader;
+
+
+static size_t align8(size_t n) {
+    return (n + 7) & ~(size_t)7;
+}
+
+/* 64-bit content hash, eight bytes per step so that checking an image
+   costs a small fraction of lexing the same source. */
+static uint64_t source_hash(const char *data, size_t len) {
+    const uint64_t k = 0x9E3779B97F4A7C15ULL;
+    uint64_t h = len * k;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t w;
+        memcpy(&w, data + i, 8);
+        h = (h ^ w) * k;
+        h ^= h >> 29;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, data + i, len - i);
+    h = (h ^ tail) * k;
+    h ^= h >> 32;
+    return h;
+}
+
+/* Copy a table's entries into the image, appending their bytes to the pool. */
+static void write_table(char *image, const ImageHeader *h, uint64_t table_offset,
+                        SymbolTable *table, size_t *pool_used) {
+    ImageString *out = (ImageString *)(image + table_offset);
+    for (size_t id = 0; id < table->symbols->count; id++) {
+        const Symbol *sym = symbol_get(table, id);
+        out[id].offset = *pool_used;
+        out[id].len = sym->len;
+        memcpy(image + h->pool_offset + *pool_used, sym->name, sym->len + 1);
+        *pool_used += sym->len + 1;
+    }
+}
+
+static size_t table_bytes(SymbolTable *table) {
+    size_t bytes = 0;
+    for (size_t id = 0; id < table->symbols->count; id++)
+        bytes += symbol_get(table, id)->len + 1;
+    return bytes;
+}
+
+/*
+ * Lexed program -> image file. The file is written under a temporary name
+ * and renamed into place, so readers never observe a partial image.
+ */
+ReturnStatus image_write(const char *path, const char *source, size_t source_len, Buffer *markers) {
+    SymbolTable symbols, strings;
+    if (symbol_table_init(&symbols) != RETURN_STATUS_SUCCESS)
+        return RETURN_STATUS_RUNTIME_ERROR;
+    if (symbol_table_init(&strings) != RETURN_STATUS_SUCCESS) {
+        symbol_table_destroy(&symbols);
+        return RETURN_STATUS_RUNTIME_ERROR;
+    }
+
+    ReturnStatus status = RETURN_STATUS_SUCCESS;
+    size_t count = markers->count;
+    int64_t *literals = calloc(count ? count : 1, sizeof(int64_t));
+    char *decoded = malloc(source_len + 1);
+    if (!literals || !decoded)
+        status = RETURN_STATUS_RUNTIME_ERROR;
+    for (size_t i = 0; i < count && status == RETURN_STATUS_SUCCESS; i++) {
+        Marker *m = (Marker *)buffer_nth(markers, i);
+        size_t id = 0;
+        if (m->type == MARKER_INT || m->type == MARKER_FLOAT) {
+            literals[i] = marker_int_value(m, source);
+        } else if (m->type == MARKER_SYMBOL) {
+            status = symbol_intern(&symbols, source + m->bidx, m->eidx - m->bidx, &id);
+            literals[i] = (int64_t)id;
+        } else if (m->type == MARKER_STRING) {
+            size_t len = string_decode(source + m->bidx + 1, m->eidx - m->bidx - 2, decoded);
+            status = symbol_intern(&strings, decoded, len, &id);
+            literals[i] = (int64_t)id;
+        }
+    }
+    free(decoded);
+
+    ImageHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC));
+    header.version = IMAGE_VERSION;
+    header.marker_size = sizeof(Marker);
+    header.source_hash = source_hash(source, source_len);
+    header.source_len = source_len;
+    header.marker_count = count;
+    header.symbol_count = symbols.symbols->count;
+    header.string_count = strings.symbols->count;
+    header.markers_offset = align8(sizeof(ImageHeader));
+    header.literals_offset = align8(header.markers_offset + count * sizeof(Marker));
+    header.symbols_offset = align8(header.literals_offset + count * sizeof(int64_t));
+    header.strings_offset = align8(header.symbols_offset + header.symbol_count * sizeof(ImageString));
+    header.pool_offset = align8(header.strings_offset + header.string_count * sizeof(ImageString));
+    header.pool_size = table_bytes(&symbols) + table_bytes(&strings);
+    header.total_size = header.pool_offset + header.pool_size;
+
+    char *image = NULL;
+    if (status == RETURN_STATUS_SUCCESS)
+        image = calloc(1, header.total_size);
+    if (image) {
+        memcpy(image, &header, sizeof(header));
+        if (count) {
+            memcpy(image + header.markers_offset, markers->data, count * sizeof(Marker));
+            memcpy(image + header.literals_offset, literals, count * sizeof(int64_t));
+        }
+        size_t pool_used = 0;
+        write_table(image, &header, header.symbols_offset, &symbols, &pool_used);
+        write_table(image, &header, header.strings_offset, &strings, &pool_used);
+
+        size_t tmp_len = strlen(path) + 5;
+        char *tmp = malloc(tmp_len);
+        FILE *fp = NULL;
+        if (tmp) {
+            snprintf(tmp, tmp_len, "%s.tmp", path);
+            fp = fopen(tmp, "wb");
+        }
+        if (!fp) {
+            status = RETURN_STATUS_RUNTIME_ERROR;
+        } else {
+            size_t written = fwrite(image, 1, header.total_size, fp);
+            if (fclose(fp) != 0 || written != header.total_size || rename(tmp, path) != 0) {
+                remove(tmp);
+                status = RETURN_STATUS_RUNTIME_ERROR;
+            }
+        }
+        free(tmp);
+        free(image);
+    } else {
+        status = RETURN_STATUS_RUNTIME_ERROR;
+    }
+
+    free(literals);
+    symbol_table_destroy(&symbols);
+    symbol_table_destroy(&strings);
+    return status;
+}
+
+static int section_fits(const ImageHeader *h, uint64_t offset, uint64_t count, uint64_t size) {
+    return offset % 8 == 0 && offset <= h->total_size &&
+           (size == 0 || count <= (h->total_size - offset) / size);
+}
+
+/* Every entry must lie inside the pool and be NUL-terminated. */
+static int table_fits(const ImageString *table, size_t count, const char *pool, uint64_t pool_size) {
+    for (size_t i = 0; i < count; i++) {
+        if (table[i].offset >= pool_size || table[i].len >= pool_size - table[i].offset ||
+            pool[table[i].offset + table[i].len] != '\0')
+            return 0;
+    }
+    return 1;
+}
+
+/*
+ * Every marker must be what read_markers could have produced for a source
+ * of source_len bytes: text inside the source, a jump forward within the
+ * markers (for ')', back to a '(' or SIZE_MAX), and literal indexes inside
+ * the tables.
+ */
+static int markers_fit(const Image *image, size_t source_len) {
+    const Marker *markers = (const Marker *)image->markers.data;
+    size_t count = image->markers.count;
+    for (size_t i = 0; i < count; i++) {
+        const Marker *m = &markers[i];
+        if ((unsigned)m->type > MARKER_NIL || m->bidx > m->eidx || m->eidx > source_len)
+            return 0;
+        if (m->type == MARKER_RPAREN) {
+            if (m->jump != SIZE_MAX && (m->jump >= i || markers[m->jump].type != MARKER_LPAREN))
+                return 0;
+        } else if (m->jump <= i || m->jump > count) {
+            return 0;
+        }
+        int64_t literal = image->literals[i];
+        if ((m->type == MARKER_SYMBOL && (literal < 0 || (uint64_t)literal >= image->symbol_count)) ||
+            (m->type == MARKER_STRING && (literal < 0 || (uint64_t)literal >= image->string_count ||
+                                          m->eidx - m->bidx < 2)))
+            return 0;
+    }
+    return 1;
+}
+
+/*
+ * Map the image at path for the given source. Returns
+ * RETURN_STATUS_RETRYABLE_ERROR when the image is missing, stale (source
+ * hash differs), corrupt or written by an incompatible build; the caller
+ * should then lex the source and may rewrite the image.
+ */
+ReturnStatus image_open(Image *image, const char *path, const char *source, size_t source_len) {
+    memset(image, 0, sizeof(*image));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return RETURN_STATUS_RETRYABLE_ERROR;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ImageHeader)) {
+        close(fd);
+        return RETURN_STATUS_RETRYABLE_ERROR;
+    }
+    void *base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return RETURN_STATUS_RETRYABLE_ERROR;
+    image->base = base;
+    image->size = st.st_size;
+
+    const ImageHeader *h = (const ImageHeader *)base;
+    if (memcmp(h->magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) != 0 ||
+        h->version != IMAGE_VERSION ||
+        h->marker_size != sizeof(Marker) ||
+        h->total_size != image->size ||
+        h->source_len != source_len ||
+        !section_fits(h, h->markers_offset, h->marker_count, sizeof(Marker)) ||
+        !section_fits(h, h->literals_offset, h->marker_count, sizeof(int64_t)) ||
+        !section_fits(h, h->symbols_offset, h->symbol_count, sizeof(ImageString)) ||
+        !section_fits(h, h->strings_offset, h->string_count, sizeof(ImageString)) ||
+        !section_fits(h, h->pool_offset, h->pool_size, 1) ||
+        h->source_hash != source_hash(source, source_len)) {
+        image_close(image);
+        return RETURN_STATUS_RETRYABLE_ERROR;
+    }
+
+    const char *bytes = (const char *)base;
+    image->markers.data = (void *)(bytes + h->markers_offset);
+    image->markers.element_size = sizeof(Marker);
+    image->markers.capacity = h->marker_count;
+    image->markers.count = h->marker_count;
+    image->literals = (const int64_t *)(bytes + h->literals_offset);
+    image->symbols = (const ImageString *)(bytes + h->symbols_offset);
+    image->symbol_count = h->symbol_count;
+    image->strings = (const ImageString *)(bytes + h->strings_offset);
+    image->string_count = h->string_count;
+    image->pool = bytes + h->pool_offset;
+
+    if (!table_fits(image->symbols, image->symbol_count, image->pool, h->pool_size) ||
+        !table_fits(image->strings, image->string_count, image->pool, h->pool_size) ||
+        !markers_fit(image, source_len)) {
+        image_close(image);
+        return RETURN_STATUS_RETRYABLE_ERROR;
+    }
+    return RETURN_STATUS_SUCCESS;
+}
+
+/*
+ * Resolve the image's symbols against an interpreter's symbol table. This
+ * costs one intern per distinct symbol, independent of the program size.
+ * String literals are interned lazily, the first time each is evaluated.
+ */
+ReturnStatus image_bind(Image *image, SymbolTable *symbols) {
+    free(image->symbol_map);
+    free(image->string_map);
+    image->symbol_map = malloc((image->symbol_count ? image->symbol_count : 1) * sizeof(size_t));
+    image->string_map = malloc((image->string_count ? image->string_count : 1) * sizeof(size_t));
+    if (!image->symbol_map || !image->string_map)
+        return RETURN_STATUS_RUNTIME_ERROR;
+    memset(image->string_map, 0xFF, image->string_count * sizeof(size_t));  // SIZE_MAX: not interned yet
+    for (size_t i = 0; i < image->symbol_count; i++) {
+        const ImageString *sym = &image->symbols[i];
+        ReturnStatus status = symbol_intern(symbols, image->pool + sym->offset, sym->len,
+                                            &image->symbol_map[i]);
+        if (status != RETURN_STATUS_SUCCESS)
+            return status;
+    }
+    return RETURN_STATUS_SUCCESS;
+}
+
+void image_close(Image *image) {
+    if (image->base)
+        munmap(image->base, image->size);
+    free(image->symbol_map);
+    free(image->string_map);
+    memset(image, 0, sizeof(*image));
+}
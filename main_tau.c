@@ -28,11 +28,29 @@ int main(void) {
         "42.5",
         "#f",
         "#t",
+        "'(1 2 3)",
+        "`(a b ,@(list 1 2) ,(+ 1 2))",
+        "(append '(1 2) (list 3 4))",
+        "(reverse (cons 1 (cons 2 nil)))",
+        "(if (<= 3 1) 1 (* 3 2))",
+        "(cond ((> 1 2) 'a) ((= 2 2) 'b) (else 'c))",
+        "(and (< 1 2 3) (or #f 'x))",
+        "(* 9223372036854775807 9223372036854775807)",
+        "(define-syntax swap (syntax-rules () ((_ a b) (list b a))))",
+        "(swap 1 (swap 2 3))",
+        "(define-syntax my-or (syntax-rules () ((_) #f) ((_ e r ...) (if e e (my-or r ...)))))",
+        "(my-or #f #f 7)",
+        "#`(a #,(swap 1 2) #,@(list 3 4))",
         NULL
     };
     
 
     Buffer *buf __attribute__ ((__cleanup__(buffer_cleanup))) = buffer_create(sizeof(Marker), 1024);
+    Interp interp __attribute__ ((__cleanup__(interp_destroy)));
+    if (interp_init(&interp) != RETURN_STATUS_SUCCESS) {
+        fprintf(stderr, "Error creating interpreter.\n");
+        return 1;
+    }
     for (const char **p = expressions; *p != NULL; p++) {
         buffer_clear(buf);
         printf("Expression: %s\n", *p);
@@ -41,7 +59,7 @@ int main(void) {
         } else {
             pretty_print_markers(buf, *p);
         }
-        eval_buffer(buf, *p);
+        eval_buffer(&interp, buf, *p);
         printf("\n\n");
     }
     
@@ -0,0 +1,264 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include "tau.h"
+
+/*
+ * Client and load generator for main_tau_server. Without -n it sends one
+ * request and prints the response. With -n it opens -c connections, keeps
+ * up to -p requests in flight on each, and reports latency percentiles over
+ * all of them and the throughput of those that did not answer with an error.
+ */
+
+typedef struct {
+    const char *path;
+    const char *expr;
+    size_t requests;      // Requests this connection sends
+    size_t depth;         // Maximum requests in flight
+    double *latencies;    // Seconds, one per request
+    size_t errors;        // Responses reporting an error
+    int failed;
+} LoadConn;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int connect_unix(const char *path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        fprintf(stderr, "Error connecting to %s: %s\n", path, strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int write_all(int fd, const void *data, size_t len) {
+    const char *p = data;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return 0;
+        p += n;
+        len -= n;
+    }
+    return 1;
+}
+
+static int read_all(int fd, void *data, size_t len) {
+    char *p = data;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return 0;
+        p += n;
+        len -= n;
+    }
+    return 1;
+}
+
+/* Build the frame for expr once; every request on a connection reuses it. */
+static char *make_frame(const char *expr, size_t *frame_len) {
+    size_t len = strlen(expr);
+    char *frame = malloc(TAU_FRAME_HEADER + len);
+    if (!frame)
+        return NULL;
+    frame[0] = (char)(len >> 24);
+    frame[1] = (char)(len >> 16);
+    frame[2] = (char)(len >> 8);
+    frame[3] = (char)len;
+    memcpy(frame + TAU_FRAME_HEADER, expr, len);
+    *frame_len = TAU_FRAME_HEADER + len;
+    return frame;
+}
+
+/* Read one response frame into a malloc'd, NUL-terminated payload. */
+static char *read_frame(int fd, size_t *len_out) {
+    unsigned char header[TAU_FRAME_HEADER];
+    if (!read_all(fd, header, sizeof(header)))
+        return NULL;
+    size_t len = ((size_t)header[0] << 24) | ((size_t)header[1] << 16) |
+                 ((size_t)header[2] << 8) | header[3];
+    if (len > TAU_FRAME_MAX)
+        return NULL;
+    char *payload = malloc(len + 1);
+    if (!payload)
+        return NULL;
+    if (!read_all(fd, payload, len)) {
+        free(payload);
+        return NULL;
+    }
+    payload[len] = '\0';
+    *len_out = len;
+    return payload;
+}
+
+static void *load_main(void *arg) {
+    LoadConn *lc = arg;
+    size_t frame_len = 0;
+    char *frame = make_frame(lc->expr, &frame_len);
+    double *sent_at = malloc(lc->depth * sizeof(double));  // Ring of in-flight send times
+    int fd = frame && sent_at ? connect_unix(lc->path) : -1;
+    if (fd < 0) {
+        lc->failed = 1;
+        free(frame);
+        free(sent_at);
+        return NULL;
+    }
+    size_t sent = 0, received = 0;
+    while (received < lc->requests) {
+        while (sent < lc->requests && sent - received < lc->depth) {
+            sent_at[sent % lc->depth] = now_seconds();
+            if (!write_all(fd, frame, frame_len))
+                goto fail;
+            sent++;
+        }
+        size_t len;
+        char *response = read_frame(fd, &len);
+        if (!response)
+            goto fail;
+        // Responses come back in request order on a connection.
+        lc->latencies[received] = now_seconds() - sent_at[received % lc->depth];
+        received++;
+        // The server stops a batch at its first error and reports it on the last line.
+        if (strncmp(response, "error:", 6) == 0 || strstr(response, "\nerror:"))
+            lc->errors++;
+        free(response);
+    }
+    close(fd);
+    free(frame);
+    free(sent_at);
+    return NULL;
+fail:
+    fprintf(stderr, "Connection failed after %zu responses\n", received);
+    lc->failed = 1;
+    close(fd);
+    free(frame);
+    free(sent_at);
+    return NULL;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static int run_load(const char *path, const char *expr, size_t connections,
+                    size_t requests, size_t depth) {
+    LoadConn *conns = calloc(connections, sizeof(LoadConn));
+    pthread_t *threads = calloc(connections, sizeof(pthread_t));
+    double *latencies = malloc(requests * sizeof(double));
+    if (!conns || !threads || !latencies) {
+        fprintf(stderr, "Error allocating load generator state\n");
+        free(conns);
+        free(threads);
+        free(latencies);
+        return 1;
+    }
+
+    size_t offset = 0, started = 0;
+    double start = now_seconds();
+    for (; started < connections; started++) {
+        LoadConn *lc = &conns[started];
+        lc->path = path;
+        lc->expr = expr;
+        lc->requests = requests / connections + (started < requests % connections);
+        lc->depth = depth;
+        lc->latencies = latencies + offset;
+        offset += lc->requests;
+        if (pthread_create(&threads[started], NULL, load_main, lc) != 0)
+            break;
+    }
+    int failed = started < connections;
+    size_t errors = 0;
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+        failed |= conns[i].failed;
+        errors += conns[i].errors;
+    }
+    double elapsed = now_seconds() - start;
+
+    if (!failed) {
+        qsort(latencies, requests, sizeof(double), compare_double);
+        printf("%zu requests over %zu connections (pipeline depth %zu)\n", requests, connections, depth);
+        printf("  p50 %8.1f us\n", latencies[requests / 2] * 1e6);
+        printf("  p99 %8.1f us\n", latencies[requests * 99 / 100] * 1e6);
+        printf("  max %8.1f us\n", latencies[requests - 1] * 1e6);
+        printf("  %zu error responses\n", errors);
+        printf("  %.0f successful requests/s\n", (requests - errors) / elapsed);
+    }
+    free(conns);
+    free(threads);
+    free(latencies);
+    return failed || errors > 0;
+}
+
+int main(int argc, char **argv) {
+    const char *path = TAU_SOCKET_PATH;
+    size_t connections = 1, requests = 0, depth = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:c:n:p:")) != -1) {
+        switch (opt) {
+            case 's': path = optarg; break;
+            case 'c': connections = strtoul(optarg, NULL, 10); break;
+            case 'n': requests = strtoul(optarg, NULL, 10); break;
+            case 'p': depth = strtoul(optarg, NULL, 10); break;
+            default:
+                fprintf(stderr, "Usage: %s [-s socket] [-c connections] [-n requests] "
+                                "[-p pipeline-depth] [expression]\n", argv[0]);
+                return 1;
+        }
+    }
+    const char *expr = optind < argc ? argv[optind] : "(+ 1 2)";
+    if (strlen(expr) > TAU_FRAME_MAX) {
+        fprintf(stderr, "Expression exceeds %u bytes\n", TAU_FRAME_MAX);
+        return 1;
+    }
+    if (connections == 0)
+        connections = 1;
+    if (depth == 0)
+        depth = 1;
+    if (requests > 0) {
+        if (connections > requests)
+            connections = requests;
+        return run_load(path, expr, connections, requests, depth);
+    }
+
+    int fd = connect_unix(path);
+    if (fd < 0)
+        return 1;
+    size_t frame_len, len;
+    char *frame = make_frame(expr, &frame_len);
+    char *response = NULL;
+    if (frame && write_all(fd, frame, frame_len))
+        response = read_frame(fd, &len);
+    free(frame);
+    close(fd);
+    if (!response) {
+        fprintf(stderr, "No response from server\n");
+        return 1;
+    }
+    fwrite(response, 1, len, stdout);
+    free(response);
+    return 0;
+}
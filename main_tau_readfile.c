@@ -1,15 +1,37 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
 #include "tau.h"
 
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
 int main(int argc, char **argv) {
-    if (argc < 2) {
-        fprintf(stderr, "Usage: %s <file-path>\n", argv[0]);
+    const char *image_path = NULL;
+    int evaluate = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "c:e")) != -1) {
+        switch (opt) {
+            case 'c': image_path = optarg; break;
+            case 'e': evaluate = 1; break;
+            default:
+                fprintf(stderr, "Usage: %s [-c image-path] [-e] <file-path>\n", argv[0]);
+                return 1;
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "Usage: %s [-c image-path] [-e] <file-path>\n", argv[0]);
         return 1;
     }
+    const char *path = argv[optind];
+    double start = now_ms();
     
     /* Open file */
-    FILE *fp = fopen(argv[1], "rb");
+    FILE *fp = fopen(path, "rb");
     if (!fp) {
         perror("fopen");
         return 1;
@@ -40,23 +62,78 @@ int main(int argc, char **argv) {
     buffer[read_bytes] = '\0';  /* Ensure null termination */
     fclose(fp);
     
-    /* Create marker buffer and parse file contents */
-    Buffer *buf = buffer_create(sizeof(Marker), 1024);
-    if (!buf) {
-        fprintf(stderr, "Error creating marker buffer\n");
-        free(buffer);
-        return 1;
-    }
-    if (read_markers(buffer, buf) != RETURN_STATUS_SUCCESS) {
-        fprintf(stderr, "Error parsing markers\n");
-        buffer_destroy(buf);
-        free(buffer);
-        return 1;
+    /* Use the precompiled image when it matches the source; otherwise lex
+       the file and, if an image path was given, write a fresh image. */
+    Image image = { 0 };
+    Buffer *buf = NULL;
+    Buffer *markers;
+    if (image_path && image_open(&image, image_path, buffer, read_bytes) == RETURN_STATUS_SUCCESS) {
+        markers = &image.markers;
+        fprintf(stderr, "Warm start: mapped %zu markers from %s in %.3f ms\n",
+                markers->count, image_path, now_ms() - start);
+    } else {
+        /* Create marker buffer and parse file contents */
+        buf = buffer_create(sizeof(Marker), 1024);
+        if (!buf) {
+            fprintf(stderr, "Error creating marker buffer\n");
+            free(buffer);
+            return 1;
+        }
+        if (read_markers(buffer, buf) != RETURN_STATUS_SUCCESS) {
+            fprintf(stderr, "Error parsing markers\n");
+            buffer_destroy(buf);
+            free(buffer);
+            return 1;
+        }
+        markers = buf;
+        fprintf(stderr, "Cold start: lexed %zu markers in %.3f ms\n", markers->count, now_ms() - start);
+        if (image_path && image_write(image_path, buffer, read_bytes, buf) != RETURN_STATUS_SUCCESS)
+            fprintf(stderr, "Warning: could not write image %s\n", image_path);
     }
     
-    /* Print the markers */
-    pretty_print_markers(buf, buffer);
+    if (evaluate) {
+        Interp interp __attribute__ ((__cleanup__(interp_destroy)));
+        Buffer *text __attribute__ ((__cleanup__(buffer_cleanup))) = buffer_create(sizeof(char), 1024);
+        Buffer *expanded __attribute__ ((__cleanup__(buffer_cleanup))) = buffer_create(sizeof(Marker), 1024);
+        if (!text || !expanded || interp_init(&interp) != RETURN_STATUS_SUCCESS) {
+            fprintf(stderr, "Error creating interpreter\n");
+        } else if (interp_expand(&interp, markers, buffer, text, expanded) != RETURN_STATUS_SUCCESS) {
+            fprintf(stderr, "Error expanding macros\n");
+        } else {
+            /* Expansion is timed on its own; an unchanged program is
+               evaluated straight from the original markers or image. */
+            const ExpandStats *stats = &interp.expander.stats;
+            fprintf(stderr, "Expanded %zu macro calls (%zu cached), %zu templates in %.3f ms\n",
+                    stats->calls, stats->cache_hits, stats->templates, stats->ns / 1e6);
+            double eval_start = now_ms();
+            Buffer *program = text->count ? expanded : markers;
+            size_t index = 0;
+            while (index < program->count) {
+                size_t form = index;
+                Value result;
+                ReturnStatus status = text->count
+                    ? interp_eval(&interp, expanded, text->data, &index, &result)
+                    : buf
+                    ? interp_eval(&interp, buf, buffer, &index, &result)
+                    : interp_eval_image(&interp, &image, buffer, &index, &result);
+                if (status != RETURN_STATUS_SUCCESS) {
+                    fprintf(stderr, "Error evaluating expression ending at marker index %zu\n", index);
+                    // index stopped inside the form; resume after the whole form.
+                    const Marker *m = (const Marker *)buffer_nth(program, form);
+                    index = m->type != MARKER_RPAREN && m->jump > form ? m->jump : form + 1;
+                    continue;
+                }
+                value_print(&interp, &result, stdout);
+                printf("\n");
+            }
+            fprintf(stderr, "Evaluated in %.3f ms\n", now_ms() - eval_start);
+        }
+    } else {
+        /* Print the markers */
+        pretty_print_markers(markers, buffer);
+    }
     
+    image_close(&image);
     buffer_destroy(buf);
     free(buffer);
     return 0;
@@ -0,0 +1,682 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "tau.h"
+
+/*
+ * Evaluation daemon. One thread runs an epoll loop that accepts clients,
+ * reads request frames and queues them; a pool of workers evaluates them.
+ * Every worker owns a warm Interp (symbols, heap, macro cache) and every
+ * connection is pinned to one worker, so a client's requests are answered
+ * in order. Definitions are shared: the top-level define-syntax and struct
+ * forms of a batch that evaluates without error go into a common log, in
+ * order, and each worker replays the entries it has not seen before its
+ * next request. The log is the source of truth for a worker's state: a
+ * worker whose failed batch defined something, or whose interpreter has
+ * interned more than SERVER_MAX_INTERNED symbols, strings and struct
+ * layouts, starts over with a fresh interpreter and replays the log.
+ *
+ * A connection stops being read while it has SERVER_MAX_QUEUED requests
+ * waiting or SERVER_MAX_OUTPUT bytes unsent, so a client that writes
+ * faster than it reads is slowed down instead of growing the server.
+ * After the client shuts down its write side, the queued requests are
+ * still answered, then the server shuts down its own.
+ */
+
+#define SERVER_MAX_EVENTS 64
+#define SERVER_DEFAULT_WORKERS 4
+#define SERVER_MAX_QUEUED 64
+#define SERVER_MAX_OUTPUT (4u * 1024 * 1024)
+#define SERVER_MAX_INTERNED 100000
+
+typedef struct Connection Connection;
+
+struct Connection {
+    int fd;
+    size_t worker;         // Index of the worker that owns this connection
+    pthread_mutex_t lock;  // Guards everything below except in, prev and next
+    int refs;              // One for the event loop plus one per queued request
+    int closed;
+    int eof;               // The client will send nothing more
+    size_t queued;         // Requests submitted but not yet answered
+    uint32_t events;       // Registered epoll events
+    Buffer *out;           // char: framed responses not yet sent
+    size_t out_sent;       // Bytes of out already written
+    Buffer *in;            // char: received bytes not yet framed (event loop only)
+    Connection *prev;      // Open connections list (event loop only)
+    Connection *next;
+};
+
+typedef struct Request {
+    Connection *conn;
+    char *payload;         // NUL-terminated batch of expressions
+    struct Request *next;
+} Request;
+
+typedef enum { DEFINE_MACRO, DEFINE_STRUCT, DEFINE_KINDS } DefinitionKind;
+
+typedef struct {
+    char *text;            // Owned source of the define-syntax or struct form
+    size_t owner;          // Index of the worker that made it
+} Definition;
+
+typedef struct {
+    pthread_mutex_t lock;
+    Buffer *log;           // Definition, in the order they were made
+    SymbolTable names;     // Every defined name
+    Buffer *latest;        // size_t[DEFINE_KINDS] per name: log index of its current definition
+} Definitions;
+
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    Request *head;
+    Request *tail;
+    int stopping;
+    int epfd;
+    Interp interp;
+    Buffer *markers;
+    Buffer *text;         // char, the request after macro expansion
+    Buffer *expanded;     // Marker, lexed from text
+    size_t index;         // Position in the worker array
+    Definitions *defs;
+    size_t defs_seen;     // Log entries already applied to interp
+    size_t served;
+    size_t resets;
+    size_t interned;      // worker_interned() right after the last reset
+} Worker;
+
+static volatile sig_atomic_t running = 1;
+
+static void handle_signal(int sig) {
+    (void)sig;
+    running = 0;
+}
+
+static void connection_release(Connection *conn) {
+    pthread_mutex_lock(&conn->lock);
+    int last = --conn->refs == 0;
+    pthread_mutex_unlock(&conn->lock);
+    if (!last)
+        return;
+    close(conn->fd);
+    pthread_mutex_destroy(&conn->lock);
+    buffer_destroy(conn->in);
+    buffer_destroy(conn->out);
+    free(conn);
+}
+
+/*
+ * Register the events conn can act on: EPOLLIN unless the client is done
+ * or too far ahead, EPOLLOUT while output remains. Once the client is done
+ * and everything is answered, shut down the write side; the resulting
+ * EPOLLHUP tells the event loop to close. Called with conn->lock held.
+ */
+static void connection_watch(Connection *conn, int epfd) {
+    if (conn->closed)
+        return;
+    size_t pending = conn->out->count - conn->out_sent;
+    uint32_t events = (pending ? EPOLLOUT : 0);
+    if (!conn->eof && conn->queued < SERVER_MAX_QUEUED && pending < SERVER_MAX_OUTPUT)
+        events |= EPOLLIN;
+    if (events != conn->events) {
+        struct epoll_event ev = { .events = events, .data.ptr = conn };
+        epoll_ctl(epfd, EPOLL_CTL_MOD, conn->fd, &ev);
+        conn->events = events;
+    }
+    if (conn->eof && !conn->queued && !pending)
+        shutdown(conn->fd, SHUT_WR);
+}
+
+/*
+ * Write as much pending output as the socket accepts, then update the
+ * registered events. Called with conn->lock held.
+ */
+static void connection_flush(Connection *conn, int epfd) {
+    while (conn->out_sent < conn->out->count) {
+        ssize_t n = send(conn->fd, (char *)conn->out->data + conn->out_sent,
+                         conn->out->count - conn->out_sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            conn->out_sent += n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+                conn->out_sent = conn->out->count;  // Peer is gone; drop the output.
+            break;
+        }
+    }
+    if (conn->out_sent == conn->out->count)
+        conn->out->count = conn->out_sent = 0;
+    connection_watch(conn, epfd);
+}
+
+static void worker_buffers_destroy(Worker *w) {
+    buffer_destroy(w->markers);
+    buffer_destroy(w->text);
+    buffer_destroy(w->expanded);
+}
+
+/*
+ * Expand and evaluate source on the worker's interpreter, printing each
+ * result to out unless it is NULL. Returns 1 if the whole batch evaluated.
+ */
+static int worker_run(Worker *w, const char *source, FILE *out) {
+    w->markers->count = 0;
+    if (read_markers(source, w->markers) != RETURN_STATUS_SUCCESS) {
+        if (out)
+            fprintf(out, "error: could not read expressions\n");
+        return 0;
+    }
+    if (interp_expand(&w->interp, w->markers, source, w->text, w->expanded) != RETURN_STATUS_SUCCESS) {
+        if (out)
+            fprintf(out, "error: macro expansion failed\n");
+        return 0;
+    }
+    Buffer *markers = w->text->count ? w->expanded : w->markers;
+    const char *input = w->text->count ? w->text->data : source;
+    size_t index = 0;
+    while (index < markers->count) {
+        Value result;
+        if (interp_eval(&w->interp, markers, input, &index, &result) != RETURN_STATUS_SUCCESS) {
+            // The rest of the batch cannot be resynchronized after an error.
+            if (out)
+                fprintf(out, "error: evaluation failed at marker %zu\n", index);
+            return 0;
+        }
+        if (out) {
+            value_print(&w->interp, &result, out);
+            fputc('\n', out);
+        }
+    }
+    return 1;
+}
+
+/*
+ * Replay log entries from index on. Called with defs->lock held: the log's
+ * storage may move when another worker appends.
+ */
+static void worker_replay(Worker *w, size_t index) {
+    Buffer *log = w->defs->log;
+    for (; index < log->count; index++)
+        worker_run(w, ((Definition *)buffer_nth(log, index))->text, NULL);
+    w->defs_seen = log->count;
+}
+
+/*
+ * Apply what other workers logged since this one last looked. Once there
+ * is a foreign entry, this worker's own later entries are replayed too, so
+ * the last definition of a name in log order is the one that holds. They
+ * evaluated once already, so errors are not expected and are ignored.
+ */
+static void worker_catch_up(Worker *w) {
+    Definitions *defs = w->defs;
+    pthread_mutex_lock(&defs->lock);
+    size_t i = w->defs_seen;
+    while (i < defs->log->count && ((Definition *)buffer_nth(defs->log, i))->owner == w->index)
+        i++;
+    worker_replay(w, i);
+    pthread_mutex_unlock(&defs->lock);
+}
+
+/* Symbols, strings and struct layouts the worker's interpreter holds. */
+static size_t worker_interned(Worker *w) {
+    Interp *interp = &w->interp;
+    return interp->symbols.symbols->count + interp->strings.symbols->count +
+           (interp->structs.layouts ? interp->structs.layouts->count : 0);
+}
+
+/*
+ * Replace the worker's interpreter with a fresh one and replay the whole
+ * log into it. Expansion statistics carry over.
+ */
+static void worker_reset(Worker *w) {
+    ExpandStats stats = w->interp.expander.stats;
+    interp_destroy(&w->interp);
+    if (interp_init(&w->interp) != RETURN_STATUS_SUCCESS) {
+        fprintf(stderr, "Error resetting worker %zu\n", w->index);
+        exit(1);
+    }
+    w->interp.expander.stats = stats;
+    w->resets++;
+    pthread_mutex_lock(&w->defs->lock);
+    worker_replay(w, 0);
+    pthread_mutex_unlock(&w->defs->lock);
+    w->interned = worker_interned(w);
+}
+
+/*
+ * Log one definition unless it repeats the current one for its name.
+ * Returns 0 on allocation failure. Called with defs->lock held.
+ */
+static int defs_append(Definitions *defs, DefinitionKind kind, const char *name, size_t name_len,
+                        const char *text, size_t len, size_t owner) {
+    size_t id;
+    if (symbol_intern(&defs->names, name, name_len, &id) != RETURN_STATUS_SUCCESS)
+        return 0;
+    if (id == defs->latest->count) {
+        size_t none[DEFINE_KINDS] = { SIZE_MAX, SIZE_MAX };
+        if (!buffer_push(defs->latest, none))
+            return 0;
+    }
+    size_t *latest = (size_t *)buffer_nth(defs->latest, id) + kind;
+    if (*latest != SIZE_MAX) {
+        const char *current = ((Definition *)buffer_nth(defs->log, *latest))->text;
+        if (strlen(current) == len && memcmp(current, text, len) == 0)
+            return 1;
+    }
+    Definition def = { .text = malloc(len + 1), .owner = owner };
+    if (!def.text)
+        return 0;
+    memcpy(def.text, text, len);
+    def.text[len] = '\0';
+    if (!buffer_push(defs->log, &def)) {
+        free(def.text);
+        return 0;
+    }
+    *latest = defs->log->count - 1;
+    return 1;
+}
+
+/* Log the top-level definitions of source, whose markers are in w->markers. */
+static void worker_publish(Worker *w, const char *source) {
+    Definitions *defs = w->defs;
+    Buffer *markers = w->markers;
+    for (size_t i = 0; i < markers->count;) {
+        Marker *m = (Marker *)buffer_nth(markers, i);
+        Marker *head = (Marker *)buffer_nth(markers, i + 1);
+        Marker *name = (Marker *)buffer_nth(markers, i + 2);
+        i = m->type == MARKER_RPAREN ? i + 1 : m->jump;  // A ')' jumps back to its '('
+        if (m->type != MARKER_LPAREN || !head || head->type != MARKER_SYMBOL ||
+            !name || name->type != MARKER_SYMBOL)
+            continue;
+        size_t len = head->eidx - head->bidx;
+        DefinitionKind kind;
+        if (len == 13 && memcmp(source + head->bidx, "define-syntax", 13) == 0)
+            kind = DEFINE_MACRO;
+        else if (len == 6 && memcmp(source + head->bidx, "struct", 6) == 0)
+            kind = DEFINE_STRUCT;
+        else
+            continue;
+        Marker *last = (Marker *)buffer_nth(markers, m->jump - 1);
+        pthread_mutex_lock(&defs->lock);
+        if (!defs_append(defs, kind, source + name->bidx, name->eidx - name->bidx,
+                         source + m->bidx, last->eidx - m->bidx, w->index))
+            fprintf(stderr, "Warning: could not share a definition\n");
+        pthread_mutex_unlock(&defs->lock);
+    }
+}
+
+/*
+ * Evaluate a batch into a response payload, after replaying definitions
+ * made elsewhere and expanding its macros. A failed batch leaves no
+ * definitions behind. A response too long for one frame is replaced by an
+ * error. Returns NULL on allocation failure.
+ */
+static char *worker_eval(Worker *w, const char *payload, size_t *len_out) {
+    char *response = NULL;
+    FILE *out = open_memstream(&response, len_out);
+    if (!out)
+        return NULL;
+    worker_catch_up(w);
+    Interp *interp = &w->interp;
+    size_t generation = interp->expander.generation;
+    size_t structs = interp->structs.layouts ? interp->structs.layouts->count : 0;
+    if (worker_run(w, payload, out))
+        worker_publish(w, payload);
+    else if (generation != interp->expander.generation ||
+             structs != (interp->structs.layouts ? interp->structs.layouts->count : 0))
+        worker_reset(w);  // Drop what the batch defined before it failed.
+    if (worker_interned(w) - w->interned > SERVER_MAX_INTERNED)
+        worker_reset(w);  // Client-supplied symbols and strings accumulate otherwise.
+    if (fclose(out) != 0) {
+        free(response);
+        return NULL;
+    }
+    if (*len_out > TAU_FRAME_MAX) {
+        size_t len = *len_out;
+        free(response);
+        response = malloc(128);
+        if (response)
+            *len_out = snprintf(response, 128, "error: response of %zu bytes exceeds the frame limit\n", len);
+    }
+    return response;
+}
+
+static void *worker_main(void *arg) {
+    Worker *w = arg;
+    while (1) {
+        pthread_mutex_lock(&w->lock);
+        while (!w->head && !w->stopping)
+            pthread_cond_wait(&w->ready, &w->lock);
+        Request *req = w->head;
+        if (req) {
+            w->head = req->next;
+            if (!w->head)
+                w->tail = NULL;
+        }
+        pthread_mutex_unlock(&w->lock);
+        if (!req)
+            break;  // Stopping and drained.
+
+        Connection *conn = req->conn;
+        pthread_mutex_lock(&conn->lock);
+        int closed = conn->closed;
+        pthread_mutex_unlock(&conn->lock);
+
+        size_t len = 0;
+        char *response = closed ? NULL : worker_eval(w, req->payload, &len);
+        if (response) {
+            unsigned char header[TAU_FRAME_HEADER] = {
+                (unsigned char)(len >> 24), (unsigned char)(len >> 16),
+                (unsigned char)(len >> 8), (unsigned char)len,
+            };
+            pthread_mutex_lock(&conn->lock);
+            if (!conn->closed && !(buffer_extend(conn->out, header, sizeof(header)) &&
+                                   buffer_extend(conn->out, response, len)))
+                fprintf(stderr, "Warning: dropped a response of %zu bytes\n", len);
+            pthread_mutex_unlock(&conn->lock);
+            free(response);
+            w->served++;
+        }
+        pthread_mutex_lock(&conn->lock);
+        conn->queued--;
+        if (!conn->closed)
+            connection_flush(conn, w->epfd);
+        pthread_mutex_unlock(&conn->lock);
+        connection_release(conn);
+        free(req->payload);
+        free(req);
+    }
+    return NULL;
+}
+
+static int worker_submit(Worker *w, Connection *conn, const char *payload, size_t len) {
+    Request *req = malloc(sizeof(Request));
+    char *copy = malloc(len + 1);
+    if (!req || !copy) {
+        free(req);
+        free(copy);
+        return 0;
+    }
+    memcpy(copy, payload, len);
+    copy[len] = '\0';
+    req->conn = conn;
+    req->payload = copy;
+    req->next = NULL;
+
+    pthread_mutex_lock(&conn->lock);
+    conn->refs++;
+    conn->queued++;
+    pthread_mutex_unlock(&conn->lock);
+
+    pthread_mutex_lock(&w->lock);
+    if (w->tail)
+        w->tail->next = req;
+    else
+        w->head = req;
+    w->tail = req;
+    pthread_cond_signal(&w->ready);
+    pthread_mutex_unlock(&w->lock);
+    return 1;
+}
+
+static void connection_close(Connection **list, Connection *conn, int epfd) {
+    pthread_mutex_lock(&conn->lock);
+    conn->closed = 1;
+    pthread_mutex_unlock(&conn->lock);
+    epoll_ctl(epfd, EPOLL_CTL_DEL, conn->fd, NULL);
+    if (conn->prev)
+        conn->prev->next = conn->next;
+    else
+        *list = conn->next;
+    if (conn->next)
+        conn->next->prev = conn->prev;
+    connection_release(conn);
+}
+
+/*
+ * Queue every complete frame in conn->in, then read more unless the client
+ * is done or too far ahead. The frames of one read are all queued, so the
+ * queue overshoots SERVER_MAX_QUEUED by at most one chunk's worth. Returns
+ * 0 once the connection should be closed.
+ */
+static int connection_read(Connection *conn, Worker *workers, int epfd) {
+    char chunk[65536];
+    while (1) {
+        const unsigned char *data = conn->in->data;
+        size_t pos = 0;
+        while (conn->in->count - pos >= TAU_FRAME_HEADER) {
+            size_t len = ((size_t)data[pos] << 24) | ((size_t)data[pos + 1] << 16) |
+                         ((size_t)data[pos + 2] << 8) | data[pos + 3];
+            if (len > TAU_FRAME_MAX)
+                return 0;
+            if (conn->in->count - pos - TAU_FRAME_HEADER < len)
+                break;
+            if (!worker_submit(&workers[conn->worker], conn,
+                               (const char *)data + pos + TAU_FRAME_HEADER, len))
+                return 0;
+            pos += TAU_FRAME_HEADER + len;
+        }
+        memmove(conn->in->data, data + pos, conn->in->count - pos);
+        conn->in->count -= pos;
+
+        pthread_mutex_lock(&conn->lock);
+        int paused = conn->eof || conn->queued >= SERVER_MAX_QUEUED ||
+                     conn->out->count - conn->out_sent >= SERVER_MAX_OUTPUT;
+        pthread_mutex_unlock(&conn->lock);
+        if (paused)
+            break;
+
+        ssize_t n = read(conn->fd, chunk, sizeof(chunk));
+        if (n > 0) {
+            if (!buffer_extend(conn->in, chunk, n))
+                return 0;
+        } else if (n == 0) {
+            pthread_mutex_lock(&conn->lock);
+            conn->eof = 1;  // Answer what is queued, then shut down (see connection_watch).
+            pthread_mutex_unlock(&conn->lock);
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        } else if (errno != EINTR) {
+            return 0;
+        }
+    }
+    pthread_mutex_lock(&conn->lock);
+    connection_watch(conn, epfd);
+    pthread_mutex_unlock(&conn->lock);
+    return 1;
+}
+
+static int listen_unix(const char *path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        perror("bind/listen");
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+int main(int argc, char **argv) {
+    size_t worker_count = SERVER_DEFAULT_WORKERS;
+    int opt;
+    while ((opt = getopt(argc, argv, "w:")) != -1) {
+        switch (opt) {
+            case 'w': worker_count = strtoul(optarg, NULL, 10); break;
+            default:
+                fprintf(stderr, "Usage: %s [-w workers] [socket-path]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (worker_count == 0)
+        worker_count = 1;
+    const char *path = optind < argc ? argv[optind] : TAU_SOCKET_PATH;
+
+    struct sigaction sa = { .sa_handler = handle_signal };
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    int listen_fd = listen_unix(path);
+    if (listen_fd < 0)
+        return 1;
+    int epfd = epoll_create1(0);
+    struct epoll_event lev = { .events = EPOLLIN, .data.ptr = NULL };
+    if (epfd < 0 || epoll_ctl(epfd, EPOLL_CTL_ADD, listen_fd, &lev) != 0) {
+        perror("epoll");
+        close(listen_fd);
+        return 1;
+    }
+
+    Definitions defs = {
+        .lock = PTHREAD_MUTEX_INITIALIZER,
+        .log = buffer_create(sizeof(Definition), 64),
+        .latest = buffer_create(DEFINE_KINDS * sizeof(size_t), 64),
+    };
+    if (!defs.log || !defs.latest || symbol_table_init(&defs.names) != RETURN_STATUS_SUCCESS) {
+        fprintf(stderr, "Error creating the definitions log\n");
+        return 1;
+    }
+    Worker *workers = calloc(worker_count, sizeof(Worker));
+    size_t started = 0;
+    for (; workers && started < worker_count; started++) {
+        Worker *w = &workers[started];
+        w->epfd = epfd;
+        w->index = started;
+        w->defs = &defs;
+        w->markers = buffer_create(sizeof(Marker), 1024);
+        w->text = buffer_create(sizeof(char), 1024);
+        w->expanded = buffer_create(sizeof(Marker), 1024);
+        pthread_mutex_init(&w->lock, NULL);
+        pthread_cond_init(&w->ready, NULL);
+        if (!w->markers || !w->text || !w->expanded || interp_init(&w->interp) != RETURN_STATUS_SUCCESS) {
+            worker_buffers_destroy(w);
+            break;
+        }
+        w->interned = worker_interned(w);
+        if (pthread_create(&w->thread, NULL, worker_main, w) != 0) {
+            interp_destroy(&w->interp);
+            worker_buffers_destroy(w);
+            break;
+        }
+    }
+    if (started < worker_count) {
+        fprintf(stderr, "Error starting workers\n");
+        running = 0;
+    } else {
+        fprintf(stderr, "Listening on %s with %zu workers\n", path, worker_count);
+    }
+
+    Connection *connections = NULL;
+    size_t next_worker = 0;
+    struct epoll_event events[SERVER_MAX_EVENTS];
+    while (running) {
+        int n = epoll_wait(epfd, events, SERVER_MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("epoll_wait");
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            Connection *conn = events[i].data.ptr;
+            if (!conn) {
+                int fd;
+                while ((fd = accept(listen_fd, NULL, NULL)) >= 0) {
+                    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                    conn = calloc(1, sizeof(Connection));
+                    if (conn) {
+                        conn->in = buffer_create(sizeof(char), 4096);
+                        conn->out = buffer_create(sizeof(char), 4096);
+                    }
+                    if (!conn || !conn->in || !conn->out) {
+                        if (conn) {
+                            buffer_destroy(conn->in);
+                            buffer_destroy(conn->out);
+                        }
+                        free(conn);
+                        close(fd);
+                        continue;
+                    }
+                    conn->fd = fd;
+                    conn->refs = 1;
+                    conn->worker = next_worker++ % worker_count;
+                    conn->events = EPOLLIN;
+                    pthread_mutex_init(&conn->lock, NULL);
+                    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = conn };
+                    epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+                    conn->next = connections;
+                    if (connections)
+                        connections->prev = conn;
+                    connections = conn;
+                }
+                continue;
+            }
+            if (events[i].events & EPOLLOUT) {
+                pthread_mutex_lock(&conn->lock);
+                connection_flush(conn, epfd);
+                pthread_mutex_unlock(&conn->lock);
+            }
+            // EPOLLHUP means both directions are shut down: the client closed,
+            // or it half-closed and every response has been sent.
+            if ((events[i].events & (EPOLLHUP | EPOLLERR)) ||
+                ((events[i].events & EPOLLIN) && !connection_read(conn, workers, epfd)))
+                connection_close(&connections, conn, epfd);
+        }
+    }
+
+    while (connections)
+        connection_close(&connections, connections, epfd);
+    size_t served = 0, resets = 0, calls = 0, cache_hits = 0;
+    uint64_t expand_ns = 0;
+    for (size_t i = 0; i < started; i++) {
+        Worker *w = &workers[i];
+        pthread_mutex_lock(&w->lock);
+        w->stopping = 1;
+        pthread_cond_signal(&w->ready);
+        pthread_mutex_unlock(&w->lock);
+        pthread_join(w->thread, NULL);
+        served += w->served;
+        resets += w->resets;
+        calls += w->interp.expander.stats.calls;
+        cache_hits += w->interp.expander.stats.cache_hits;
+        expand_ns += w->interp.expander.stats.ns;
+        interp_destroy(&w->interp);
+        worker_buffers_destroy(w);
+        pthread_mutex_destroy(&w->lock);
+        pthread_cond_destroy(&w->ready);
+    }
+    fprintf(stderr, "Served %zu requests (%zu interpreter resets)\n", served, resets);
+    fprintf(stderr, "Expanded %zu macro calls (%zu cached) in %.3f ms\n", calls, cache_hits, expand_ns / 1e6);
+    free(workers);
+    for (size_t i = 0; i < defs.log->count; i++)
+        free(((Definition *)buffer_nth(defs.log, i))->text);
+    buffer_destroy(defs.log);
+    buffer_destroy(defs.latest);
+    symbol_table_destroy(&defs.names);
+    close(epfd);
+    close(listen_fd);
+    unlink(path);
+    return 0;
+}
@@ -0,0 +1,370 @@
+#include "tau.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/*
+ * X-Macro for the scalar field types a struct may contain.
+ * Every type is naturally aligned, so its size doubles as its alignment.
+ */
+#define FIELD_TYPES(X)          \
+    X(FIELD_I8,  "i8",  1)      \
+    X(FIELD_I16, "i16", 2)      \
+    X(FIELD_I32, "i32", 4)      \
+    X(FIELD_I64, "i64", 8)      \
+    X(FIELD_U8,  "u8",  1)      \
+    X(FIELD_U16, "u16", 2)      \
+    X(FIELD_U32, "u32", 4)      \
+    X(FIELD_U64, "u64", 8)      \
+    X(FIELD_F32, "f32", 4)      \
+    X(FIELD_F64, "f64", 8)
+
+
+static size_t field_type_size(FieldType type) {
+    switch (type) {
+        #define X(TYPE, NAME, SIZE) case TYPE: return SIZE;
+        FIELD_TYPES(X)
+        #undef X
+    }
+    return 0;
+}
+
+static size_t align_up(size_t n, size_t align) {
+    return (n + align - 1) & ~(align - 1);
+}
+
+const char *field_type_to_string(FieldType type) {
+    switch (type) {
+        #define X(TYPE, NAME, SIZE) case TYPE: return NAME;
+        FIELD_TYPES(X)
+        #undef X
+    }
+    return "unknown";
+}
+
+/* Returns 1 and fills type_out if name[0..len) names a field type, 0 otherwise. */
+int field_type_from_string(const char *name, size_t len, FieldType *type_out) {
+    #define X(TYPE, NAME, SIZE)                                         \
+        if (len == sizeof(NAME) - 1 && strncmp(name, NAME, len) == 0) { \
+            *type_out = TYPE;                                           \
+            return 1;                                                   \
+        }
+    FIELD_TYPES(X)
+    #undef X
+    return 0;
+}
+
+ReturnStatus struct_layout_init(StructLayout *layout, const char *name, size_t len) {
+    if (!layout || !name || len == 0 || len >= STRUCT_NAME_MAX)
+        return RETURN_STATUS_VALUE_ERROR;
+    memset(layout, 0, sizeof(*layout));
+    memcpy(layout->name, name, len);
+    layout->align = 1;
+    return RETURN_STATUS_SUCCESS;
+}
+
+ReturnStatus struct_layout_add_field(StructLayout *layout, const char *name, size_t len, FieldType type) {
+    if (!layout || !name || len == 0 || len >= STRUCT_NAME_MAX)
+        return RETURN_STATUS_VALUE_ERROR;
+    if (layout->field_count == STRUCT_FIELDS_MAX)
+        return RETURN_STATUS_VALUE_ERROR;
+    if (struct_layout_field(layout, name, len))
+        return RETURN_STATUS_VALUE_ERROR; // Duplicate field name.
+
+    StructField *field = &layout->fields[layout->field_count++];
+    memcpy(field->name, name, len);
+    field->name[len] = '\0';
+    field->type = type;
+    field->size = field_type_size(type);
+    field->offset = 0;
+    return RETURN_STATUS_SUCCESS;
+}
+
+/*
+ * Compute field offsets. Fields are placed in order of decreasing size
+ * (ties keep declaration order); since every size is a power of two this
+ * leaves no interior padding, only tail padding up to the record alignment.
+ * The fields array itself stays in declaration order.
+ */
+void struct_layout_finish(StructLayout *layout) {
+    size_t order[STRUCT_FIELDS_MAX];
+    for (size_t i = 0; i < layout->field_count; i++) {
+        size_t j = i;
+        while (j > 0 && layout->fields[order[j - 1]].size < layout->fields[i].size) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+
+    size_t offset = 0;
+    layout->align = 1;
+    for (size_t i = 0; i < layout->field_count; i++) {
+        StructField *field = &layout->fields[order[i]];
+        offset = align_up(offset, field->size);
+        field->offset = offset;
+        offset += field->size;
+        if (field->size > layout->align)
+            layout->align = field->size;
+    }
+    layout->size = align_up(offset, layout->align);
+}
+
+const StructField *struct_layout_field(const StructLayout *layout, const char *name, size_t len) {
+    for (size_t i = 0; i < layout->field_count; i++) {
+        const StructField *field = &layout->fields[i];
+        if (strlen(field->name) == len && strncmp(field->name, name, len) == 0)
+            return field;
+    }
+    return NULL;
+}
+
+/*
+ * Register a copy of a finished layout. Redefining a struct shadows the
+ * previous definition; the old layout stays alive for vectors that use it.
+ */
+ReturnStatus struct_register(StructRegistry *registry, const StructLayout *layout) {
+    if (!registry->layouts) {
+        registry->layouts = buffer_create(sizeof(StructLayout *), 16);
+        if (!registry->layouts)
+            return RETURN_STATUS_RUNTIME_ERROR;
+    }
+    StructLayout *copy = malloc(sizeof(StructLayout));
+    if (!copy)
+        return RETURN_STATUS_RUNTIME_ERROR;
+    memcpy(copy, layout, sizeof(StructLayout));
+    if (!buffer_push(registry->layouts, &copy)) {
+        free(copy);
+        return RETURN_STATUS_RUNTIME_ERROR;
+    }
+    return RETURN_STATUS_SUCCESS;
+}
+
+const StructLayout *struct_lookup(StructRegistry *registry, const char *name, size_t len) {
+    if (!registry->layouts)
+        return NULL;
+    for (size_t i = registry->layouts->count; i > 0; i--) {
+        StructLayout *layout = *(StructLayout **)buffer_nth(registry->layouts, i - 1);
+        if (strlen(layout->name) == len && strncmp(layout->name, name, len) == 0)
+            return layout;
+    }
+    return NULL;
+}
+
+void struct_registry_destroy(StructRegistry *registry) {
+    if (!registry->layouts)
+        return;
+    for (size_t i = 0; i < registry->layouts->count; i++)
+        free(*(StructLayout **)buffer_nth(registry->layouts, i));
+    buffer_destroy(registry->layouts);
+    registry->layouts = NULL;
+}
+
+/*
+ * Parse the body of a struct form, i.e. everything after the `struct`
+ * operator up to (but not including) the form's closing paren:
+ *
+ *     name ((field type) ...)
+ *
+ * The finished layout is registered and returned through layout_out.
+ */
+ReturnStatus struct_define_from_markers(StructRegistry *registry, size_t *index, Buffer *buf,
+                                        const char *input, const StructLayout **layout_out) {
+    Marker *m = (Marker *)buffer_nth(buf, *index);
+    if (!m || m->type != MARKER_SYMBOL) {
+        fprintf(stderr, "Error: Expected struct name.\n");
+        return RETURN_STATUS_RUNTIME_ERROR;
+    }
+    StructLayout layout;
+    if (struct_layout_init(&layout, input + m->bidx, m->eidx - m->bidx) != RETURN_STATUS_SUCCESS) {
+        fprintf(stderr, "Error: Invalid struct name '%.*s'.\n", (int)(m->eidx - m->bidx), input + m->bidx);
+        return RETURN_STATUS_RUNTIME_ERROR;
+    }
+    (*index)++;  // Consume name.
+
+    m = (Marker *)buffer_nth(buf, *index);
+    if (!m || m->type != MARKER_LPAREN) {
+        fprintf(stderr, "Error: Expected field list for struct '%s'.\n", layout.name);
+        return RETURN_STATUS_RUNTIME_ERROR;
+    }
+    (*index)++;  // Consume '(' of the field list.
+
+    while (1) {
+        m = (Marker *)buffer_nth(buf, *index);
+        if (!m) {
+            fprintf(stderr, "Error: Unexpected end of struct '%s'.\n", layout.name);
+            return RETURN_STATUS_RUNTIME_ERROR;
+        }
+        if (m->type == MARKER_RPAREN) {
+            (*index)++;  // Consume ')' of the field list.
+            break;
+        }
+
+        Marker *open = m;
+        Marker *fname = (Marker *)buffer_nth(buf, *index + 1);
+        Marker *ftype = (Marker *)buffer_nth(buf, *index + 2);
+        Marker *close = (Marker *)buffer_nth(buf, *index + 3);
+        if (open->type != MARKER_LPAREN ||
+            !fname || fname->type != MARKER_SYMBOL ||
+            !ftype || ftype->type != MARKER_SYMBOL ||
+            !close || close->type != MARKER_RPAREN) {
+            fprintf(stderr, "Error: Expected (field type) in struct '%s'.\n", layout.name);
+            return RETURN_STATUS_RUNTIME_ERROR;
+        }
+        FieldType type;
+        if (!field_type_from_string(input + ftype->bidx, ftype->eidx - ftype->bidx, &type)) {
+            fprintf(stderr, "Error: Unknown field type '%.*s'.\n",
+                    (int)(ftype->eidx - ftype->bidx), input + ftype->bidx);
+            return RETURN_STATUS_RUNTIME_ERROR;
+        }
+        if (struct_layout_add_field(&layout, input + fname->bidx, fname->eidx - fname->bidx, type)
+            != RETURN_STATUS_SUCCESS) {
+            fprintf(stderr, "Error: Invalid or duplicate field '%.*s' in struct '%s'.\n",
+                    (int)(fname->eidx - fname->bidx), input + fname->bidx, layout.name);
+            return RETURN_STATUS_RUNTIME_ERROR;
+        }
+        *index += 4;  // Consume (field type).
+    }
+
+    struct_layout_finish(&layout);
+    ReturnStatus status = struct_register(registry, &layout);
+    if (status != RETURN_STATUS_SUCCESS)
+        return status;
+    *layout_out = struct_lookup(registry, layout.name, strlen(layout.name));
+    return RETURN_STATUS_SUCCESS;
+}
+
+
+/* Byte offsets of each SoA column for a given capacity. Returns the total size. */
+static size_t struct_vec_plan_columns(const StructLayout *layout, size_t capacity, size_t *columns) {
+    size_t offset = 0;
+    for (size_t i = 0; i < layout->field_count; i++) {
+        offset = align_up(offset, layout->fields[i].size);
+        columns[i] = offset;
+        offset += capacity * layout->fields[i].size;
+    }
+    return offset;
+}
+
+/* Create a struct vector with a given storage mode and initial capacity. */
+StructVec* struct_vec_create(const StructLayout *layout, StructStorage storage, size_t initial_capacity) {
+    if (!layout)
+        return NULL;
+    StructVec *vec = calloc(1, sizeof(StructVec));
+    if (!vec)
+        return NULL;
+    vec->layout = layout;
+    vec->storage = storage;
+    vec->capacity = initial_capacity ? initial_capacity : 1;
+
+    size_t bytes = (storage == STRUCT_STORAGE_AOS)
+        ? vec->capacity * layout->size
+        : struct_vec_plan_columns(layout, vec->capacity, vec->columns);
+    vec->data = malloc(bytes ? bytes : 1);
+    if (!vec->data) {
+        free(vec);
+        return NULL;
+    }
+    return vec;
+}
+
+void struct_vec_destroy(StructVec *vec) {
+    if (vec) {
+        free(vec->data);
+        free(vec);
+    }
+}
+
+void struct_vec_cleanup(StructVec **vec) {
+    struct_vec_destroy(*vec);
+}
+
+/* Resize the vector. SoA columns are moved individually into the new block.
+   Returns 1 on success, 0 on failure. */
+static int struct_vec_resize(StructVec *vec, size_t new_capacity) {
+    const StructLayout *layout = vec->layout;
+    if (vec->storage == STRUCT_STORAGE_AOS) {
+        void *new_data = realloc(vec->data, new_capacity * layout->size);
+        if (!new_data) return 0;
+        vec->data = new_data;
+        vec->capacity = new_capacity;
+        return 1;
+    }
+
+    size_t new_columns[STRUCT_FIELDS_MAX];
+    size_t bytes = struct_vec_plan_columns(layout, new_capacity, new_columns);
+    char *new_data = malloc(bytes ? bytes : 1);
+    if (!new_data) return 0;
+    for (size_t i = 0; i < layout->field_count; i++) {
+        memcpy(new_data + new_columns[i], (char *)vec->data + vec->columns[i],
+               vec->count * layout->fields[i].size);
+        vec->columns[i] = new_columns[i];
+    }
+    free(vec->data);
+    vec->data = new_data;
+    vec->capacity = new_capacity;
+    return 1;
+}
+
+/*
+ * Append one record. The record is read in AoS layout (layout->size bytes,
+ * fields at their layout offsets); NULL appends a zeroed record.
+ * Returns 1 on success and 0 on failure.
+ */
+int struct_vec_push(StructVec *vec, const void *record) {
+    if (vec->count == vec->capacity) {
+        if (!struct_vec_resize(vec, vec->capacity * 2))
+            return 0;
+    }
+    const StructLayout *layout = vec->layout;
+    size_t n = vec->count++;
+    if (vec->storage == STRUCT_STORAGE_AOS) {
+        void *target = (char *)vec->data + n * layout->size;
+        if (record)
+            memcpy(target, record, layout->size);
+        else
+            memset(target, 0, layout->size);
+        return 1;
+    }
+    for (size_t i = 0; i < layout->field_count; i++) {
+        const StructField *field = &layout->fields[i];
+        void *target = (char *)vec->data + vec->columns[i] + n * field->size;
+        if (record)
+            memcpy(target, (const char *)record + field->offset, field->size);
+        else
+            memset(target, 0, field->size);
+    }
+    return 1;
+}
+
+/*
+ * Returns a pointer to field `field` (declaration index) of element n,
+ * or NULL if either is out of bounds.
+ */
+void* struct_vec_field(StructVec *vec, size_t n, size_t field) {
+    if (n >= vec->count || field >= vec->layout->field_count)
+        return NULL;
+    const StructField *f = &vec->layout->fields[field];
+    if (vec->storage == STRUCT_STORAGE_AOS)
+        return (char *)vec->data + n * vec->layout->size + f->offset;
+    return (char *)vec->data + vec->columns[field] + n * f->size;
+}
+
+/*
+ * Returns a pointer to field `field` of element 0 and stores in stride_out
+ * the byte distance between consecutive elements' copies of that field.
+ * Column loops written against (base, stride) work for both storage modes;
+ * in SoA mode the stride equals the field size and the loop is contiguous.
+ */
+void* struct_vec_column(StructVec *vec, size_t field, size_t *stride_out) {
+    if (field >= vec->layout->field_count)
+        return NULL;
+    const StructField *f = &vec->layout->fields[field];
+    if (vec->storage == STRUCT_STORAGE_AOS) {
+        *stride_out = vec->layout->size;
+        return (char *)vec->data + f->offset;
+    }
+    *stride_out = f->size;
+    return (char *)vec->data + vec->columns[field];
+}
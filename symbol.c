@@ -0,0 +1,98 @@
+#include "tau.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+#define SYMBOL_TABLE_INITIAL_SLOTS 256
+
+/* FNV-1a over the symbol's bytes. */
+static size_t symbol_hash(const char *name, size_t len) {
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)name[i];
+        h *= 1099511628211ULL;
+    }
+    return (size_t)h;
+}
+
+ReturnStatus symbol_table_init(SymbolTable *table) {
+    table->symbols = buffer_create(sizeof(Symbol), SYMBOL_TABLE_INITIAL_SLOTS / 2);
+    table->slots = calloc(SYMBOL_TABLE_INITIAL_SLOTS, sizeof(size_t));
+    table->slot_count = SYMBOL_TABLE_INITIAL_SLOTS;
+    if (!table->symbols || !table->slots) {
+        symbol_table_destroy(table);
+        return RETURN_STATUS_RUNTIME_ERROR;
+    }
+    return RETURN_STATUS_SUCCESS;
+}
+
+void symbol_table_destroy(SymbolTable *table) {
+    if (table->symbols) {
+        for (size_t i = 0; i < table->symbols->count; i++)
+            free((char *)((Symbol *)buffer_nth(table->symbols, i))->name);
+        buffer_destroy(table->symbols);
+    }
+    free(table->slots);
+    table->symbols = NULL;
+    table->slots = NULL;
+    table->slot_count = 0;
+}
+
+/* Double the slot array and reinsert every symbol. Returns 1 on success, 0 on failure. */
+static int symbol_table_grow(SymbolTable *table) {
+    size_t new_count = table->slot_count * 2;
+    size_t *new_slots = calloc(new_count, sizeof(size_t));
+    if (!new_slots) return 0;
+    for (size_t id = 0; id < table->symbols->count; id++) {
+        Symbol *sym = (Symbol *)buffer_nth(table->symbols, id);
+        size_t slot = symbol_hash(sym->name, sym->len) & (new_count - 1);
+        while (new_slots[slot] != 0)
+            slot = (slot + 1) & (new_count - 1);
+        new_slots[slot] = id + 1;
+    }
+    free(table->slots);
+    table->slots = new_slots;
+    table->slot_count = new_count;
+    return 1;
+}
+
+/*
+ * Look up name[0..len), adding a copy of it if it is not interned yet.
+ * Equal names always produce the same id.
+ */
+ReturnStatus symbol_intern(SymbolTable *table, const char *name, size_t len, size_t *id_out) {
+    size_t mask = table->slot_count - 1;
+    size_t slot = symbol_hash(name, len) & mask;
+    while (table->slots[slot] != 0) {
+        size_t id = table->slots[slot] - 1;
+        Symbol *sym = (Symbol *)buffer_nth(table->symbols, id);
+        if (sym->len == len && memcmp(sym->name, name, len) == 0) {
+            *id_out = id;
+            return RETURN_STATUS_SUCCESS;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    char *copy = malloc(len + 1);
+    if (!copy)
+        return RETURN_STATUS_RUNTIME_ERROR;
+    memcpy(copy, name, len);
+    copy[len] = '\0';
+    Symbol sym = { copy, len };
+    if (!buffer_push(table->symbols, &sym)) {
+        free(copy);
+        return RETURN_STATUS_RUNTIME_ERROR;
+    }
+    *id_out = table->symbols->count - 1;
+    table->slots[slot] = *id_out + 1;
+
+    /* Keep the load factor at or below one half. */
+    if (table->symbols->count * 2 > table->slot_count && !symbol_table_grow(table))
+        return RETURN_STATUS_RUNTIME_ERROR;
+    return RETURN_STATUS_SUCCESS;
+}
+
+/* Returns the symbol with the given id, or NULL if there is none. */
+const Symbol *symbol_get(SymbolTable *table, size_t id) {
+    return (const Symbol *)buffer_nth(table->symbols, id);
+}
@@ -3,6 +3,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#if defined(__SSE2__) && !defined(TAU_NO_SIMD)
+#include <emmintrin.h>
+#endif
 
 
 /* 
@@ -80,6 +83,23 @@ int buffer_push(Buffer *buf, const void *element) {
     return 1;
 }
 
+/*
+ * Append n elements at once, growing the buffer at most once.
+ * Returns 1 on success and 0 on failure.
+ */
+int buffer_extend(Buffer *buf, const void *elements, size_t n) {
+    if (buf->count + n > buf->capacity) {
+        size_t new_capacity = (buf->capacity == 0) ? 1 : buf->capacity;
+        while (new_capacity < buf->count + n)
+            new_capacity *= 2;
+        if (!buffer_resize(buf, new_capacity))
+            return 0;
+    }
+    memcpy((char*)buf->data + (buf->count * buf->element_size), elements, n * buf->element_size);
+    buf->count += n;
+    return 1;
+}
+
 /* 
  * Returns a pointer to the nth element (0-indexed) or NULL if out of bounds.
  */
@@ -118,6 +138,99 @@ void buffer_clear(Buffer *buf) {
 }
 
 
+/*
+ * Index of the first '"', '\\' or NUL at or after i. The SSE2 path tests 16
+ * bytes per step using aligned loads; those never cross a page boundary but
+ * may read past the terminator, which is why ASan is disabled here.
+ */
+__attribute__((no_sanitize("address")))
+static size_t scan_string_body(const char *s, size_t i) {
+#if defined(__SSE2__) && !defined(TAU_NO_SIMD)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i zero = _mm_setzero_si128();
+    size_t misalign = (uintptr_t)(s + i) & 15;
+    const char *block = s + i - misalign;
+    unsigned mask = 0xFFFFu << misalign;
+    while (1) {
+        __m128i v = _mm_load_si128((const __m128i *)block);
+        __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote),
+                                                _mm_cmpeq_epi8(v, backslash)),
+                                   _mm_cmpeq_epi8(v, zero));
+        mask &= (unsigned)_mm_movemask_epi8(hit);
+        if (mask)
+            return (size_t)(block - s) + __builtin_ctz(mask);
+        block += 16;
+        mask = 0xFFFFu;
+    }
+#else
+    while (s[i] != '\0' && s[i] != '"' && s[i] != '\\')
+        i++;
+    return i;
+#endif
+}
+
+/*
+ * Jump index bookkeeping for read_markers. Markers still waiting for the end
+ * of their datum ('(' and reader prefixes) form a stack threaded through
+ * their jump fields; pending is its top, SIZE_MAX when empty.
+ */
+static int is_prefix_marker(MarkerType type) {
+    return type >= MARKER_QUOTE && type <= MARKER_UNSYNTAX_SPLICING;
+}
+
+/* A datum ended at end: prefixes waiting on it end there too. */
+static void close_prefixes(Buffer *buf, size_t *pending, size_t end) {
+    while (*pending != SIZE_MAX) {
+        Marker *p = (Marker *)buffer_nth(buf, *pending);
+        if (p->type == MARKER_LPAREN)
+            break;
+        *pending = p->jump;
+        p->jump = end;
+    }
+}
+
+/* Append a marker and resolve the jumps it completes. Returns 0 on failure. */
+static int push_marker(Buffer *buf, Marker *marker, size_t *pending) {
+    size_t n = buf->count;
+    if (marker->type == MARKER_LPAREN || is_prefix_marker(marker->type)) {
+        marker->jump = *pending;
+        if (!buffer_push(buf, marker))
+            return 0;
+        *pending = n;
+        return 1;
+    }
+    marker->jump = n + 1;
+    if (marker->type == MARKER_RPAREN) {
+        close_prefixes(buf, pending, n);  // A prefix directly before ')' has no datum.
+        marker->jump = *pending;          // SIZE_MAX if unmatched; the evaluator reports it.
+    }
+    if (!buffer_push(buf, marker))
+        return 0;
+    if (marker->type == MARKER_RPAREN && *pending != SIZE_MAX) {
+        Marker *open = (Marker *)buffer_nth(buf, *pending);
+        *pending = open->jump;
+        open->jump = n + 1;
+    }
+    close_prefixes(buf, pending, n + 1);
+    return 1;
+}
+
+/* Unclosed markers extend to the end of the buffer. */
+static ReturnStatus finish_markers(Buffer *buf, size_t pending, ReturnStatus status) {
+    while (pending != SIZE_MAX) {
+        Marker *p = (Marker *)buffer_nth(buf, pending);
+        pending = p->jump;
+        p->jump = buf->count;
+    }
+    return status;
+}
+
+/*
+ * Lex input_string onto output_buffer. Every marker's jump is the index just
+ * past the datum it begins, so a whole subexpression can be skipped in one
+ * step (see skip_expr).
+ */
 ReturnStatus read_markers(const char* input_string, Buffer* output_buffer) {
     if (!input_string || !output_buffer)
         return RETURN_STATUS_VALUE_ERROR;
@@ -139,6 +252,7 @@ ReturnStatus read_markers(const char* input_string, Buffer* output_buffer) {
     };
     const size_t num_tokens = sizeof(dispatch_table) / sizeof(dispatch_table[0]);
     
+    size_t pending = SIZE_MAX;
     size_t i = 0;
     while (input_string[i] != '\0') {
         /* Skip whitespace */
@@ -151,14 +265,17 @@ ReturnStatus read_markers(const char* input_string, Buffer* output_buffer) {
         marker.bidx = i;
         int matched = 0;
         
-        /* Check fixed tokens from the dispatch table */
+        /* Check fixed tokens from the dispatch table. Only entries sharing the
+           first byte can match, so strings and most atoms skip the scan. */
         for (size_t t = 0; t < num_tokens; t++) {
             size_t token_len = dispatch_table[t].len; // Hardcoded length.
+            if (dispatch_table[t].token[0] != input_string[i])
+                continue;
             if (strncmp(input_string + i, dispatch_table[t].token, token_len) == 0) {
                 marker.type = dispatch_table[t].type;
                 marker.eidx = i + token_len;
-                if (!buffer_push(output_buffer, &marker))
-                    return RETURN_STATUS_RUNTIME_ERROR;
+                if (!push_marker(output_buffer, &marker, &pending))
+                    return finish_markers(output_buffer, pending, RETURN_STATUS_RUNTIME_ERROR);
                 i += token_len;
                 matched = 1;
                 break;
@@ -171,26 +288,27 @@ ReturnStatus read_markers(const char* input_string, Buffer* output_buffer) {
         if (input_string[i] == '"') {
             marker.bidx = i;
             i++; // Skip opening quote.
-            while (input_string[i] != '\0' && input_string[i] != '"') {
-                if (input_string[i] == '\\') {
-                    i++; // Skip escape character.
-                    if (input_string[i] != '\0')
-                        i++;
-                    else
-                        break;
-                } else {
-                    i++;
-                }
+            /* Escapes are only skipped here; they are decoded when the
+               string's value is first needed (see string_literal). */
+            while (1) {
+                i = scan_string_body(input_string, i);
+                if (input_string[i] != '\\')
+                    break;
+                i++; // Skip escape character.
+                if (input_string[i] == '\0')
+                    break;
+                i++;
             }
             if (input_string[i] == '"') {
                 i++; // Include closing quote.
             } else {
-                return RETURN_STATUS_VALUE_ERROR; // Unclosed string literal.
+                // Unclosed string literal.
+                return finish_markers(output_buffer, pending, RETURN_STATUS_VALUE_ERROR);
             }
             marker.type = MARKER_STRING;
             marker.eidx = i;
-            if (!buffer_push(output_buffer, &marker))
-                return RETURN_STATUS_RUNTIME_ERROR;
+            if (!push_marker(output_buffer, &marker, &pending))
+                return finish_markers(output_buffer, pending, RETURN_STATUS_RUNTIME_ERROR);
             continue;
         }
         
@@ -213,6 +331,7 @@ ReturnStatus read_markers(const char* input_string, Buffer* output_buffer) {
         /* Classify the token as INT, FLOAT, or SYMBOL. */
         int isInt = 1;
         int isFloat = 0;
+        int hasDigit = 0;  // So '.' and '...' stay symbols
         size_t j = start;
         if (j < i && (input_string[j] == '+' || input_string[j] == '-'))
             j++;
@@ -229,160 +348,951 @@ ReturnStatus read_markers(const char* input_string, Buffer* output_buffer) {
                 } else if (!isdigit((unsigned char)input_string[j])) {
                     isInt = 0;
                     break;
+                } else {
+                    hasDigit = 1;
                 }
             }
-            if (isInt && !isFloat)
-                marker.type = MARKER_INT;
+            if (!isInt || !hasDigit)
+                marker.type = MARKER_SYMBOL;
             else if (isFloat)
                 marker.type = MARKER_FLOAT;
             else
-                marker.type = MARKER_SYMBOL;
+                marker.type = MARKER_INT;
         }
-        if (!buffer_push(output_buffer, &marker))
-            return RETURN_STATUS_RUNTIME_ERROR;
+        if (!push_marker(output_buffer, &marker, &pending))
+            return finish_markers(output_buffer, pending, RETURN_STATUS_RUNTIME_ERROR);
     }
     
+    return finish_markers(output_buffer, pending, RETURN_STATUS_SUCCESS);
+}
+
+
+/*
+ * X-Macro for builtin operators.
+ * interp_init interns these first and in this order, so the symbol id of a
+ * builtin's name is its Builtin value and dispatch is a switch on the id.
+ */
+#define BUILTINS(X)                              \
+    X(BUILTIN_ADD,              "+")             \
+    X(BUILTIN_SUB,              "-")             \
+    X(BUILTIN_MUL,              "*")             \
+    X(BUILTIN_QUOTE,            "quote")         \
+    X(BUILTIN_QUASIQUOTE,       "quasiquote")    \
+    X(BUILTIN_LIST,             "list")          \
+    X(BUILTIN_CONS,             "cons")          \
+    X(BUILTIN_CAR,              "car")           \
+    X(BUILTIN_CDR,              "cdr")           \
+    X(BUILTIN_LENGTH,           "length")        \
+    X(BUILTIN_NULLP,            "null?")         \
+    X(BUILTIN_APPEND,           "append")        \
+    X(BUILTIN_REVERSE,          "reverse")       \
+    X(BUILTIN_STRING_EQ,        "string=?")      \
+    X(BUILTIN_STRING_LENGTH,    "string-length") \
+    X(BUILTIN_STRUCT,           "struct")        \
+    X(BUILTIN_SIZEOF,           "sizeof")        \
+    X(BUILTIN_OFFSETOF,         "offsetof")      \
+    X(BUILTIN_NUM_EQ,           "=")             \
+    X(BUILTIN_LT,               "<")             \
+    X(BUILTIN_LE,               "<=")            \
+    X(BUILTIN_GT,               ">")             \
+    X(BUILTIN_GE,               ">=")            \
+    X(BUILTIN_IF,               "if")            \
+    X(BUILTIN_COND,             "cond")          \
+    X(BUILTIN_AND,              "and")           \
+    X(BUILTIN_OR,               "or")            \
+    X(BUILTIN_WHEN,             "when")          \
+    X(BUILTIN_ELSE,             "else")
+
+typedef enum {
+    #define X(ID, NAME) ID,
+    BUILTINS(X)
+    #undef X
+    BUILTIN_COUNT
+} Builtin;
+
+/* Register a Value slot as a GC root, or fail the enclosing function. */
+#define ROOT(interp, slot)                                  \
+    do {                                                    \
+        if (!heap_root_push(&(interp)->heap, (slot)))       \
+            return RETURN_STATUS_RUNTIME_ERROR;             \
+    } while (0)
+
+static const Value NIL_VALUE = { .type = VALUE_NIL };
+
+static ReturnStatus eval_expr(Interp *interp, size_t *index, Value *result);
+
+
+ReturnStatus interp_init(Interp *interp) {
+    memset(interp, 0, sizeof(*interp));
+    interp->scratch = buffer_create(sizeof(char), 256);
+    if (!interp->scratch ||
+        heap_init(&interp->heap, HEAP_INITIAL_SEMISPACE) != RETURN_STATUS_SUCCESS ||
+        symbol_table_init(&interp->symbols) != RETURN_STATUS_SUCCESS ||
+        symbol_table_init(&interp->strings) != RETURN_STATUS_SUCCESS ||
+        expander_init(&interp->expander) != RETURN_STATUS_SUCCESS) {
+        interp_destroy(interp);
+        return RETURN_STATUS_RUNTIME_ERROR;
+    }
+    static const char *builtin_names[] = {
+        #define X(ID, NAME) NAME,
+        BUILTINS(X)
+        #undef X
+    };
+    for (size_t b = 0; b < BUILTIN_COUNT; b++) {
+        size_t id;
+        if (symbol_intern(&interp->symbols, builtin_names[b], strlen(builtin_names[b]), &id)
+            != RETURN_STATUS_SUCCESS) {
+            interp_destroy(interp);
+            return RETURN_STATUS_RUNTIME_ERROR;
+        }
+    }
     return RETURN_STATUS_SUCCESS;
 }
 
+void interp_destroy(Interp *interp) {
+    heap_destroy(&interp->heap);
+    symbol_table_destroy(&interp->symbols);
+    struct_registry_destroy(&interp->structs);
+    symbol_table_destroy(&interp->strings);
+    buffer_destroy(interp->scratch);
+    expander_destroy(&interp->expander);
+}
 
 /*
- * Recursive evaluator.
- *
- * Parameters:
- *   index  - pointer to the current position in the marker buffer.
- *   buf    - the buffer of markers.
- *   input  - the original input string.
- *   result - output parameter to hold the computed integer.
- *
- * Returns a ReturnStatus indicating success or error.
+ * Consume the ')' closing a fixed-arity form. Returns 1 on success, 0 if the
+ * next marker is missing or is not a ')'.
  */
-ReturnStatus eval_expr(size_t *index, Buffer *buf, const char *input, int *result) {
-    Marker *m = (Marker *)buffer_nth(buf, *index);
-    if (!m) {
-        fprintf(stderr, "Error: Unexpected end of marker buffer.\n");
+static int expect_rparen(Interp *interp, size_t *index) {
+    Marker *m = (Marker *)buffer_nth(interp->markers, *index);
+    if (!m || m->type != MARKER_RPAREN) {
+        fprintf(stderr, "Error: Expected ')'.\n");
+        return 0;
+    }
+    (*index)++;  // Consume ')'
+    return 1;
+}
+
+/* Returns 1 if the next marker closes the current list, without consuming it. */
+static int at_rparen(Interp *interp, size_t index) {
+    Marker *m = (Marker *)buffer_nth(interp->markers, index);
+    return m && m->type == MARKER_RPAREN;
+}
+
+/* Move past the expression at *index without evaluating it, in one step. */
+static ReturnStatus skip_expr(Interp *interp, size_t *index) {
+    Marker *m = (Marker *)buffer_nth(interp->markers, *index);
+    if (!m || m->type == MARKER_RPAREN) {
+        fprintf(stderr, "Error: Expected an expression.\n");
         return RETURN_STATUS_RUNTIME_ERROR;
     }
-    
+    *index = m->jump;
+    return RETURN_STATUS_SUCCESS;
+}
+
+/* Move just past the ')' closing the form whose '(' is at form. */
+static ReturnStatus skip_form(Interp *interp, size_t form, size_t *index) {
+    size_t end = ((Marker *)buffer_nth(interp->markers, form))->jump;
+    Marker *close = (Marker *)buffer_nth(interp->markers, end - 1);
+    if (!close || close->type != MARKER_RPAREN || close->jump != form) {
+        fprintf(stderr, "Error: Expected ')'.\n");
+        return RETURN_STATUS_RUNTIME_ERROR;
+    }
+    *index = end;
+    return RETURN_STATUS_SUCCESS;
+}
+
+/* Everything but #f counts as true. */
+static int value_is_true(const Value *v) {
+    return v->type != VALUE_BOOL || v->as.i;
+}
+
+static ReturnStatus symbol_value(Interp *interp, const char *name, size_t len, Value *out) {
+    size_t id;
+    ReturnStatus status = symbol_intern(&interp->symbols, name, len, &id);
+    if (status != RETURN_STATUS_SUCCESS)
+        return status;
+    out->type = VALUE_SYMBOL;
+    out->as.symbol = id;
+    return RETURN_STATUS_SUCCESS;
+}
+
+/* Symbol id of the SYMBOL marker at index, from the bound image if there is one. */
+static ReturnStatus marker_symbol(Interp *interp, size_t index, const Marker *m, size_t *id_out) {
+    if (interp->image) {
+        *id_out = interp->image->symbol_map[interp->image->literals[index]];
+        return RETURN_STATUS_SUCCESS;
+    }
+    return symbol_intern(&interp->symbols, interp->input + m->bidx, m->eidx - m->bidx, id_out);
+}
+
+static void string_value(Interp *interp, size_t id, Value *out) {
+    const Symbol *str = symbol_get(&interp->strings, id);
+    out->type = VALUE_STRING;
+    out->as.string.ptr = str->name;
+    out->as.string.len = str->len;
+}
+
+/*
+ * Interned value of the STRING marker at index. Decoding happens here, the
+ * first time the literal is evaluated, not in read_markers. Escape-free
+ * literals are interned straight from the input without a temporary copy;
+ * others are decoded into the interpreter's scratch buffer first. Only the
+ * first occurrence of a distinct string is copied into the table.
+ */
+static ReturnStatus string_literal(Interp *interp, size_t index, const Marker *m, Value *out) {
+    size_t id;
+    ReturnStatus status;
+    Image *image = interp->image;
+    if (image) {
+        // Already decoded when the image was written.
+        size_t n = (size_t)image->literals[index];
+        if (image->string_map[n] == SIZE_MAX) {
+            const ImageString *str = &image->strings[n];
+            status = symbol_intern(&interp->strings, image->pool + str->offset, str->len,
+                                   &image->string_map[n]);
+            if (status != RETURN_STATUS_SUCCESS)
+                return status;
+        }
+        string_value(interp, image->string_map[n], out);
+        return RETURN_STATUS_SUCCESS;
+    }
+
+    const char *raw = interp->input + m->bidx + 1;  // Skip the quotes.
+    size_t len = m->eidx - m->bidx - 2;
+    if (memchr(raw, '\\', len)) {
+        Buffer *scratch = interp->scratch;
+        if (scratch->capacity < len && !buffer_resize(scratch, len))
+            return RETURN_STATUS_RUNTIME_ERROR;
+        len = string_decode(raw, len, scratch->data);
+        raw = scratch->data;
+    }
+    if ((status = symbol_intern(&interp->strings, raw, len, &id)) != RETURN_STATUS_SUCCESS)
+        return status;
+    string_value(interp, id, out);
+    return RETURN_STATUS_SUCCESS;
+}
+
+/*
+ * The value of the INT marker m at index. Up to 18 digits always fit in
+ * int64 and, the lexer having checked the syntax, are parsed inline; only
+ * longer literals look at the sign and may become bignums.
+ */
+static inline ReturnStatus int_literal(Interp *interp, size_t index, const Marker *m, Value *out) {
+    const char *text = interp->input + m->bidx, *end = interp->input + m->eidx;
+    size_t len = m->eidx - m->bidx;
+    if (len > 18 && len - (text[0] == '-' || text[0] == '+') > 18)
+        return bignum_parse(&interp->heap, text, len, out);
+    out->type = VALUE_INT;
+    if (interp->image) {
+        out->as.i = interp->image->literals[index];
+        return RETURN_STATUS_SUCCESS;
+    }
+    int negative = text[0] == '-';
+    text += negative || text[0] == '+';
+    int64_t v = 0;
+    for (; text < end; text++)
+        v = v * 10 + (*text - '0');
+    out->as.i = negative ? -v : v;
+    return RETURN_STATUS_SUCCESS;
+}
+
+/* The self-evaluating value of the atom marker at index (symbols read as themselves). */
+static ReturnStatus atom_value(Interp *interp, size_t index, Value *out) {
+    const Marker *m = (const Marker *)buffer_nth(interp->markers, index);
     switch (m->type) {
-        case MARKER_INT: {
-            *result = atoi(input + m->bidx);
-            (*index)++; // Consume integer marker.
+        case MARKER_INT:
+            return int_literal(interp, index, m, out);
+        case MARKER_FLOAT:
+            out->type = VALUE_INT;
+            out->as.i = interp->image ? interp->image->literals[index]
+                                      : marker_int_value(m, interp->input);
+            return RETURN_STATUS_SUCCESS;
+        case MARKER_STRING:
+            return string_literal(interp, index, m, out);
+        case MARKER_TRUE:
+        case MARKER_FALSE:
+            out->type = VALUE_BOOL;
+            out->as.i = m->type == MARKER_TRUE;
+            return RETURN_STATUS_SUCCESS;
+        case MARKER_NIL:
+            *out = NIL_VALUE;
             return RETURN_STATUS_SUCCESS;
+        case MARKER_SYMBOL:
+            out->type = VALUE_SYMBOL;
+            return marker_symbol(interp, index, m, &out->as.symbol);
+        default:
+            fprintf(stderr, "Error: Unexpected marker type: %s\n", marker_type_to_string(m->type));
+            return RETURN_STATUS_RUNTIME_ERROR;
+    }
+}
+
+/* The symbol a reader prefix marker abbreviates, e.g. ' -> quote, or NULL. */
+static const char *prefix_marker_name(MarkerType type) {
+    switch (type) {
+        case MARKER_QUOTE:             return "quote";
+        case MARKER_QUASI_QUOTE:       return "quasiquote";
+        case MARKER_UNQUOTE:           return "unquote";
+        case MARKER_UNQUOTE_SPLICING:  return "unquote-splicing";
+        case MARKER_SYNTAX:            return "syntax";
+        case MARKER_QUASI_SYNTAX:      return "quasisyntax";
+        case MARKER_UNSYNTAX:          return "unsyntax";
+        case MARKER_UNSYNTAX_SPLICING: return "unsyntax-splicing";
+        default:                       return NULL;
+    }
+}
+
+/*
+ * ListBuilder: Appends to a list in order. Both fields are GC roots, so
+ * list_builder_init must run in the frame whose root mark covers it.
+ */
+typedef struct {
+    Value head;
+    Value tail;  // Last cons, or nil while the list is empty
+} ListBuilder;
+
+static ReturnStatus list_builder_init(Interp *interp, ListBuilder *lb) {
+    lb->head = NIL_VALUE;
+    lb->tail = NIL_VALUE;
+    ROOT(interp, &lb->head);
+    ROOT(interp, &lb->tail);
+    return RETURN_STATUS_SUCCESS;
+}
+
+/* Append a (rooted) item. */
+static ReturnStatus list_builder_add(Interp *interp, ListBuilder *lb, const Value *item) {
+    Value cell;
+    ReturnStatus status = heap_cons(&interp->heap, item, &NIL_VALUE, &cell);
+    if (status != RETURN_STATUS_SUCCESS)
+        return status;
+    if (lb->tail.type == VALUE_CONS)
+        lb->tail.as.cons->cdr = cell;
+    else
+        lb->head = cell;
+    lb->tail = cell;
+    return RETURN_STATUS_SUCCESS;
+}
+
+/*
+ * Append copies of every element of a (rooted) proper list. Its own roots
+ * are released before returning, as callers run it in a loop.
+ */
+static ReturnStatus list_builder_add_all(Interp *interp, ListBuilder *lb, Value *list) {
+    size_t mark = interp->heap.roots->count;
+    Value cur = *list, item;
+    ReturnStatus status = RETURN_STATUS_SUCCESS;
+    if (!heap_root_push(&interp->heap, &cur) || !heap_root_push(&interp->heap, &item))
+        status = RETURN_STATUS_RUNTIME_ERROR;
+    while (status == RETURN_STATUS_SUCCESS && cur.type == VALUE_CONS) {
+        item = cur.as.cons->car;
+        status = list_builder_add(interp, lb, &item);
+        cur = cur.as.cons->cdr;
+    }
+    if (status == RETURN_STATUS_SUCCESS && cur.type != VALUE_NIL) {
+        fprintf(stderr, "Error: Expected a proper list.\n");
+        status = RETURN_STATUS_RUNTIME_ERROR;
+    }
+    heap_root_restore(&interp->heap, mark);
+    return status;
+}
+
+/* Build the two-element list (name inner) for a reader abbreviation. */
+static ReturnStatus wrap_prefix(Interp *interp, const char *name, Value *inner, Value *out) {
+    ListBuilder lb;
+    Value sym;
+    ReturnStatus status;
+    if ((status = list_builder_init(interp, &lb)) != RETURN_STATUS_SUCCESS ||
+        (status = symbol_value(interp, name, strlen(name), &sym)) != RETURN_STATUS_SUCCESS ||
+        (status = list_builder_add(interp, &lb, &sym)) != RETURN_STATUS_SUCCESS ||
+        (status = list_builder_add(interp, &lb, inner)) != RETURN_STATUS_SUCCESS)
+        return status;
+    *out = lb.head;
+    return RETURN_STATUS_SUCCESS;
+}
+
+/*
+ * Read the datum starting at *index as quoted data, without evaluating it.
+ * Roots registered here are released before returning.
+ */
+static ReturnStatus read_datum_rooted(Interp *interp, size_t *index, Value *out);
+
+static ReturnStatus read_datum(Interp *interp, size_t *index, Value *out) {
+    size_t mark = interp->heap.roots->count;
+    ReturnStatus status = read_datum_rooted(interp, index, out);
+    heap_root_restore(&interp->heap, mark);
+    return status;
+}
+
+static ReturnStatus read_datum_rooted(Interp *interp, size_t *index, Value *out) {
+    Marker *m = (Marker *)buffer_nth(interp->markers, *index);
+    if (!m) {
+        fprintf(stderr, "Error: Unexpected end of quoted datum.\n");
+        return RETURN_STATUS_RUNTIME_ERROR;
+    }
+    ReturnStatus status;
+    const char *prefix = prefix_marker_name(m->type);
+    if (prefix) {
+        (*index)++;  // Consume prefix.
+        Value inner = NIL_VALUE;
+        ROOT(interp, &inner);
+        if ((status = read_datum(interp, index, &inner)) != RETURN_STATUS_SUCCESS)
+            return status;
+        return wrap_prefix(interp, prefix, &inner, out);
+    }
+    if (m->type == MARKER_LPAREN) {
+        (*index)++;  // Consume '('.
+        ListBuilder lb;
+        Value item = NIL_VALUE;
+        if ((status = list_builder_init(interp, &lb)) != RETURN_STATUS_SUCCESS)
+            return status;
+        ROOT(interp, &item);
+        while (!at_rparen(interp, *index)) {
+            if ((status = read_datum(interp, index, &item)) != RETURN_STATUS_SUCCESS ||
+                (status = list_builder_add(interp, &lb, &item)) != RETURN_STATUS_SUCCESS)
+                return status;
         }
-        case MARKER_FLOAT: {
-            // For simplicity, convert to int by casting.
-            *result = (int)atof(input + m->bidx);
-            (*index)++;
+        (*index)++;  // Consume ')'
+        *out = lb.head;
+        return RETURN_STATUS_SUCCESS;
+    }
+    if (m->type == MARKER_RPAREN) {
+        fprintf(stderr, "Error: Unexpected ')'\n");
+        return RETURN_STATUS_RUNTIME_ERROR;
+    }
+    (*index)++;  // Consume atom.
+    return atom_value(interp, *index - 1, out);
+}
+
+/*
+ * Instantiate the quasiquote template starting at *index. depth counts the
+ * enclosing quasiquotes; unquotes are evaluated only at depth 1.
+ */
+static ReturnStatus eval_template_rooted(Interp *interp, size_t *index, int depth, Value *out);
+
+static ReturnStatus eval_template(Interp *interp, size_t *index, int depth, Value *out) {
+    size_t mark = interp->heap.roots->count;
+    ReturnStatus status = eval_template_rooted(interp, index, depth, out);
+    heap_root_restore(&interp->heap, mark);
+    return status;
+}
+
+static ReturnStatus eval_template_rooted(Interp *interp, size_t *index, int depth, Value *out) {
+    Marker *m = (Marker *)buffer_nth(interp->markers, *index);
+    if (!m) {
+        fprintf(stderr, "Error: Unexpected end of quasiquote template.\n");
+        return RETURN_STATUS_RUNTIME_ERROR;
+    }
+    ReturnStatus status;
+    const char *prefix = prefix_marker_name(m->type);
+    if (prefix) {
+        int inner_depth = depth;
+        if (m->type == MARKER_QUASI_QUOTE)
+            inner_depth++;
+        else if (m->type == MARKER_UNQUOTE || m->type == MARKER_UNQUOTE_SPLICING)
+            inner_depth--;
+        (*index)++;  // Consume prefix.
+        if (inner_depth == 0) {
+            if (m->type == MARKER_UNQUOTE_SPLICING) {
+                fprintf(stderr, "Error: ,@ outside of a list.\n");
+                return RETURN_STATUS_RUNTIME_ERROR;
+            }
+            return eval_expr(interp, index, out);
+        }
+        Value inner = NIL_VALUE;
+        ROOT(interp, &inner);
+        if ((status = eval_template(interp, index, inner_depth, &inner)) != RETURN_STATUS_SUCCESS)
+            return status;
+        return wrap_prefix(interp, prefix, &inner, out);
+    }
+    if (m->type == MARKER_LPAREN) {
+        (*index)++;  // Consume '('.
+        ListBuilder lb;
+        Value item = NIL_VALUE;
+        if ((status = list_builder_init(interp, &lb)) != RETURN_STATUS_SUCCESS)
+            return status;
+        ROOT(interp, &item);
+        while (!at_rparen(interp, *index)) {
+            Marker *curr = (Marker *)buffer_nth(interp->markers, *index);
+            if (!curr) {
+                fprintf(stderr, "Error: Unexpected end of quasiquote template.\n");
+                return RETURN_STATUS_RUNTIME_ERROR;
+            }
+            if (curr->type == MARKER_UNQUOTE_SPLICING && depth == 1) {
+                (*index)++;  // Consume ',@'.
+                if ((status = eval_expr(interp, index, &item)) != RETURN_STATUS_SUCCESS ||
+                    (status = list_builder_add_all(interp, &lb, &item)) != RETURN_STATUS_SUCCESS)
+                    return status;
+                continue;
+            }
+            if ((status = eval_template(interp, index, depth, &item)) != RETURN_STATUS_SUCCESS ||
+                (status = list_builder_add(interp, &lb, &item)) != RETURN_STATUS_SUCCESS)
+                return status;
+        }
+        (*index)++;  // Consume ')'
+        *out = lb.head;
+        return RETURN_STATUS_SUCCESS;
+    }
+    return read_datum(interp, index, out);
+}
+
+/*
+ * Evaluate the next argument into a (rooted) slot and require an integer.
+ * Integer literals, the common operand, skip eval_expr's dispatch.
+ */
+static ReturnStatus eval_int(Interp *interp, size_t *index, Value *out) {
+    const Marker *m = (const Marker *)buffer_nth(interp->markers, *index);
+    if (m && m->type == MARKER_INT) {
+        (*index)++;
+        return int_literal(interp, *index - 1, m, out);
+    }
+    ReturnStatus status = eval_expr(interp, index, out);
+    if (status != RETURN_STATUS_SUCCESS)
+        return status;
+    if (out->type != VALUE_INT && out->type != VALUE_BIGNUM) {
+        fprintf(stderr, "Error: Expected an integer argument.\n");
+        return RETURN_STATUS_RUNTIME_ERROR;
+    }
+    return RETURN_STATUS_SUCCESS;
+}
+
+/*
+ * acc = acc op x for + - *. Two ints take the overflow-checked int64 path;
+ * anything else, including an int64 overflow, goes through the bignum
+ * routines, which hand back an int whenever the result fits. Both operands
+ * must be in root slots.
+ */
+static ReturnStatus arith(Interp *interp, Builtin op, Value *acc, const Value *x) {
+    if (acc->type == VALUE_INT && x->type == VALUE_INT) {
+        int64_t r;
+        int overflow;
+        switch (op) {
+            case BUILTIN_ADD: overflow = __builtin_add_overflow(acc->as.i, x->as.i, &r); break;
+            case BUILTIN_SUB: overflow = __builtin_sub_overflow(acc->as.i, x->as.i, &r); break;
+            default:          overflow = __builtin_mul_overflow(acc->as.i, x->as.i, &r); break;
+        }
+        if (!overflow) {
+            acc->as.i = r;
             return RETURN_STATUS_SUCCESS;
         }
-        case MARKER_STRING: {
-            fprintf(stderr, "Error: Cannot evaluate a string as a number.\n");
+    }
+    switch (op) {
+        case BUILTIN_ADD: return bignum_add(&interp->heap, acc, x, acc);
+        case BUILTIN_SUB: return bignum_sub(&interp->heap, acc, x, acc);
+        default:          return bignum_mul(&interp->heap, acc, x, acc);
+    }
+}
+
+/* Evaluate exactly n arguments into (rooted) slots and consume the closing ')'. */
+static ReturnStatus eval_args(Interp *interp, size_t *index, Value *args, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (at_rparen(interp, *index)) {
+            fprintf(stderr, "Error: Expected %zu argument(s).\n", n);
             return RETURN_STATUS_RUNTIME_ERROR;
         }
-        case MARKER_TRUE: {
-            *result = 1;
-            (*index)++;
+        ReturnStatus status = eval_expr(interp, index, &args[i]);
+        if (status != RETURN_STATUS_SUCCESS)
+            return status;
+    }
+    return expect_rparen(interp, index) ? RETURN_STATUS_SUCCESS : RETURN_STATUS_RUNTIME_ERROR;
+}
+
+/* Whether the marker at index is the symbol else. */
+static int at_else(Interp *interp, size_t index) {
+    Marker *m = (Marker *)buffer_nth(interp->markers, index);
+    size_t id;
+    return m && m->type == MARKER_SYMBOL &&
+           marker_symbol(interp, index, m, &id) == RETURN_STATUS_SUCCESS && id == BUILTIN_ELSE;
+}
+
+/*
+ * Evaluate a compound expression ( operator expr* ) whose '(' is at form.
+ * *index points just past the operator. Special forms skip the expressions
+ * they do not evaluate with skip_expr/skip_form, whose cost does not depend
+ * on the size of what is skipped. Roots registered here are released by
+ * eval_compound.
+ */
+static ReturnStatus eval_builtin(Interp *interp, Builtin op, size_t form, size_t *index, Value *result) {
+    Buffer *buf = interp->markers;
+    const char *input = interp->input;
+    ReturnStatus status;
+    Value args[2] = { NIL_VALUE, NIL_VALUE };
+    ROOT(interp, &args[0]);
+    ROOT(interp, &args[1]);
+
+    switch (op) {
+        case BUILTIN_ADD:
+        case BUILTIN_MUL:
+            // args[0] accumulates, args[1] holds the next operand.
+            args[0].type = VALUE_INT;
+            args[0].as.i = (op == BUILTIN_ADD) ? 0 : 1;
+            while (!at_rparen(interp, *index)) {
+                if ((status = eval_int(interp, index, &args[1])) != RETURN_STATUS_SUCCESS ||
+                    (status = arith(interp, op, &args[0], &args[1])) != RETURN_STATUS_SUCCESS)
+                    return status;
+            }
+            (*index)++;  // Consume ')'
+            *result = args[0];
+            return RETURN_STATUS_SUCCESS;
+        case BUILTIN_SUB:
+            if ((status = eval_int(interp, index, &args[0])) != RETURN_STATUS_SUCCESS)
+                return status;
+            if (at_rparen(interp, *index)) {
+                // Unary minus.
+                args[1] = args[0];
+                args[0].type = VALUE_INT;
+                args[0].as.i = 0;
+                if ((status = arith(interp, op, &args[0], &args[1])) != RETURN_STATUS_SUCCESS)
+                    return status;
+            }
+            while (!at_rparen(interp, *index)) {
+                if ((status = eval_int(interp, index, &args[1])) != RETURN_STATUS_SUCCESS ||
+                    (status = arith(interp, op, &args[0], &args[1])) != RETURN_STATUS_SUCCESS)
+                    return status;
+            }
+            (*index)++;  // Consume ')'
+            *result = args[0];
+            return RETURN_STATUS_SUCCESS;
+        case BUILTIN_QUOTE:
+            if ((status = read_datum(interp, index, result)) != RETURN_STATUS_SUCCESS)
+                return status;
+            return expect_rparen(interp, index) ? RETURN_STATUS_SUCCESS : RETURN_STATUS_RUNTIME_ERROR;
+        case BUILTIN_QUASIQUOTE:
+            if ((status = eval_template(interp, index, 1, result)) != RETURN_STATUS_SUCCESS)
+                return status;
+            return expect_rparen(interp, index) ? RETURN_STATUS_SUCCESS : RETURN_STATUS_RUNTIME_ERROR;
+        case BUILTIN_LIST: {
+            ListBuilder lb;
+            if ((status = list_builder_init(interp, &lb)) != RETURN_STATUS_SUCCESS)
+                return status;
+            while (!at_rparen(interp, *index)) {
+                if ((status = eval_expr(interp, index, &args[0])) != RETURN_STATUS_SUCCESS ||
+                    (status = list_builder_add(interp, &lb, &args[0])) != RETURN_STATUS_SUCCESS)
+                    return status;
+            }
+            (*index)++;  // Consume ')'
+            *result = lb.head;
             return RETURN_STATUS_SUCCESS;
         }
-        case MARKER_FALSE: {
-            *result = 0;
-            (*index)++;
+        case BUILTIN_CONS:
+            if ((status = eval_args(interp, index, args, 2)) != RETURN_STATUS_SUCCESS)
+                return status;
+            return heap_cons(&interp->heap, &args[0], &args[1], result);
+        case BUILTIN_CAR:
+        case BUILTIN_CDR:
+            if ((status = eval_args(interp, index, args, 1)) != RETURN_STATUS_SUCCESS)
+                return status;
+            if (args[0].type != VALUE_CONS) {
+                fprintf(stderr, "Error: %s of a non-pair.\n", op == BUILTIN_CAR ? "car" : "cdr");
+                return RETURN_STATUS_RUNTIME_ERROR;
+            }
+            *result = (op == BUILTIN_CAR) ? args[0].as.cons->car : args[0].as.cons->cdr;
+            return RETURN_STATUS_SUCCESS;
+        case BUILTIN_LENGTH: {
+            if ((status = eval_args(interp, index, args, 1)) != RETURN_STATUS_SUCCESS)
+                return status;
+            int64_t n = 0;
+            Value cur = args[0];
+            for (; cur.type == VALUE_CONS; cur = cur.as.cons->cdr)
+                n++;
+            if (cur.type != VALUE_NIL) {
+                fprintf(stderr, "Error: Expected a proper list.\n");
+                return RETURN_STATUS_RUNTIME_ERROR;
+            }
+            result->type = VALUE_INT;
+            result->as.i = n;
             return RETURN_STATUS_SUCCESS;
         }
-        case MARKER_LPAREN: {
-            // Compound expression: ( operator expr* )
-            (*index)++;  // Consume '('.
-            
-            // Next marker must be an operator (a symbol).
-            Marker *opMarker = (Marker *)buffer_nth(buf, *index);
-            if (!opMarker || opMarker->type != MARKER_SYMBOL) {
-                fprintf(stderr, "Error: Expected operator symbol after '('.\n");
+        case BUILTIN_NULLP:
+            if ((status = eval_args(interp, index, args, 1)) != RETURN_STATUS_SUCCESS)
+                return status;
+            result->type = VALUE_BOOL;
+            result->as.i = args[0].type == VALUE_NIL;
+            return RETURN_STATUS_SUCCESS;
+        case BUILTIN_APPEND: {
+            // Every argument but the last is copied; the last one is shared.
+            ListBuilder lb;
+            if ((status = list_builder_init(interp, &lb)) != RETURN_STATUS_SUCCESS)
+                return status;
+            while (!at_rparen(interp, *index)) {
+                if ((status = eval_expr(interp, index, &args[0])) != RETURN_STATUS_SUCCESS)
+                    return status;
+                if (at_rparen(interp, *index)) {
+                    if (lb.tail.type == VALUE_CONS)
+                        lb.tail.as.cons->cdr = args[0];
+                    else
+                        lb.head = args[0];
+                    break;
+                }
+                if ((status = list_builder_add_all(interp, &lb, &args[0])) != RETURN_STATUS_SUCCESS)
+                    return status;
+            }
+            (*index)++;  // Consume ')'
+            *result = lb.head;
+            return RETURN_STATUS_SUCCESS;
+        }
+        case BUILTIN_REVERSE: {
+            if ((status = eval_args(interp, index, args, 1)) != RETURN_STATUS_SUCCESS)
+                return status;
+            // args[0] walks the input while args[1] accumulates the result;
+            // item is rooted because heap_cons may collect.
+            Value item = NIL_VALUE;
+            ROOT(interp, &item);
+            args[1] = NIL_VALUE;
+            while (args[0].type == VALUE_CONS) {
+                item = args[0].as.cons->car;
+                if ((status = heap_cons(&interp->heap, &item, &args[1], &args[1])) != RETURN_STATUS_SUCCESS)
+                    return status;
+                args[0] = args[0].as.cons->cdr;
+            }
+            if (args[0].type != VALUE_NIL) {
+                fprintf(stderr, "Error: Expected a proper list.\n");
+                return RETURN_STATUS_RUNTIME_ERROR;
+            }
+            *result = args[1];
+            return RETURN_STATUS_SUCCESS;
+        }
+        case BUILTIN_STRING_EQ:
+            // Interned strings are equal exactly when they share storage.
+            if ((status = eval_args(interp, index, args, 2)) != RETURN_STATUS_SUCCESS)
+                return status;
+            if (args[0].type != VALUE_STRING || args[1].type != VALUE_STRING) {
+                fprintf(stderr, "Error: string=? expects two strings.\n");
                 return RETURN_STATUS_RUNTIME_ERROR;
             }
-            int op_len = opMarker->eidx - opMarker->bidx;
-            char op[16];
-            if (op_len >= (int)sizeof(op)) {
-                fprintf(stderr, "Error: Operator too long.\n");
+            result->type = VALUE_BOOL;
+            result->as.i = args[0].as.string.ptr == args[1].as.string.ptr;
+            return RETURN_STATUS_SUCCESS;
+        case BUILTIN_STRING_LENGTH:
+            if ((status = eval_args(interp, index, args, 1)) != RETURN_STATUS_SUCCESS)
+                return status;
+            if (args[0].type != VALUE_STRING) {
+                fprintf(stderr, "Error: string-length expects a string.\n");
                 return RETURN_STATUS_RUNTIME_ERROR;
             }
-            strncpy(op, input + opMarker->bidx, op_len);
-            op[op_len] = '\0';
-            (*index)++;  // Consume operator.
-            
-            int acc;
-            ReturnStatus status;
-            if (strcmp(op, "+") == 0) {
-                acc = 0;
-                while (1) {
-                    Marker *curr = (Marker *)buffer_nth(buf, *index);
-                    if (!curr) {
-                        fprintf(stderr, "Error: Unexpected end of expression.\n");
-                        return RETURN_STATUS_RUNTIME_ERROR;
-                    }
-                    if (curr->type == MARKER_RPAREN) {
-                        (*index)++;  // Consume ')'
-                        break;
-                    }
-                    int tmp;
-                    status = eval_expr(index, buf, input, &tmp);
-                    if (status != RETURN_STATUS_SUCCESS)
-                        return status;
-                    acc += tmp;
+            result->type = VALUE_INT;
+            result->as.i = (int64_t)args[0].as.string.len;
+            return RETURN_STATUS_SUCCESS;
+        case BUILTIN_STRUCT: {
+            // (struct name ((field type) ...)) evaluates to the record size.
+            const StructLayout *layout;
+            status = struct_define_from_markers(&interp->structs, index, buf, input, &layout);
+            if (status != RETURN_STATUS_SUCCESS)
+                return status;
+            result->type = VALUE_INT;
+            result->as.i = (int64_t)layout->size;
+            return expect_rparen(interp, index) ? RETURN_STATUS_SUCCESS : RETURN_STATUS_RUNTIME_ERROR;
+        }
+        case BUILTIN_SIZEOF:
+        case BUILTIN_OFFSETOF: {
+            // (sizeof name) and (offsetof name field), resolved from the layout.
+            Marker *nameMarker = (Marker *)buffer_nth(buf, *index);
+            if (!nameMarker || nameMarker->type != MARKER_SYMBOL) {
+                fprintf(stderr, "Error: Expected struct name.\n");
+                return RETURN_STATUS_RUNTIME_ERROR;
+            }
+            const StructLayout *layout = struct_lookup(&interp->structs, input + nameMarker->bidx,
+                                                       nameMarker->eidx - nameMarker->bidx);
+            if (!layout) {
+                fprintf(stderr, "Error: Unknown struct '%.*s'\n",
+                        (int)(nameMarker->eidx - nameMarker->bidx), input + nameMarker->bidx);
+                return RETURN_STATUS_RUNTIME_ERROR;
+            }
+            (*index)++;  // Consume name.
+            result->type = VALUE_INT;
+            if (op == BUILTIN_SIZEOF) {
+                result->as.i = (int64_t)layout->size;
+            } else {
+                Marker *fieldMarker = (Marker *)buffer_nth(buf, *index);
+                const StructField *field = NULL;
+                if (fieldMarker && fieldMarker->type == MARKER_SYMBOL)
+                    field = struct_layout_field(layout, input + fieldMarker->bidx,
+                                                fieldMarker->eidx - fieldMarker->bidx);
+                if (!field) {
+                    fprintf(stderr, "Error: Expected a field of struct '%s'.\n", layout->name);
+                    return RETURN_STATUS_RUNTIME_ERROR;
                 }
-            } else if (strcmp(op, "-") == 0) {
-                int first;
-                status = eval_expr(index, buf, input, &first);
-                if (status != RETURN_STATUS_SUCCESS)
+                (*index)++;  // Consume field.
+                result->as.i = (int64_t)field->offset;
+            }
+            return expect_rparen(interp, index) ? RETURN_STATUS_SUCCESS : RETURN_STATUS_RUNTIME_ERROR;
+        }
+        case BUILTIN_NUM_EQ:
+        case BUILTIN_LT:
+        case BUILTIN_LE:
+        case BUILTIN_GT:
+        case BUILTIN_GE: {
+            // (< a b c ...) holds when every adjacent pair does; all arguments are evaluated.
+            int holds = 1;
+            if ((status = eval_int(interp, index, &args[0])) != RETURN_STATUS_SUCCESS)
+                return status;
+            while (!at_rparen(interp, *index)) {
+                if ((status = eval_int(interp, index, &args[1])) != RETURN_STATUS_SUCCESS)
                     return status;
-                Marker *curr = (Marker *)buffer_nth(buf, *index);
-                if (curr && curr->type == MARKER_RPAREN) {
-                    (*index)++;  // Consume ')'
-                    acc = -first; // Unary minus.
-                } else {
-                    acc = first;
-                    while (1) {
-                        curr = (Marker *)buffer_nth(buf, *index);
-                        if (!curr) {
-                            fprintf(stderr, "Error: Unexpected end of expression.\n");
-                            return RETURN_STATUS_RUNTIME_ERROR;
-                        }
-                        if (curr->type == MARKER_RPAREN) {
-                            (*index)++;  // Consume ')'
-                            break;
-                        }
-                        int tmp;
-                        status = eval_expr(index, buf, input, &tmp);
-                        if (status != RETURN_STATUS_SUCCESS)
-                            return status;
-                        acc -= tmp;
-                    }
+                int c = args[0].type == VALUE_INT && args[1].type == VALUE_INT
+                      ? (args[0].as.i > args[1].as.i) - (args[0].as.i < args[1].as.i)
+                      : bignum_compare(&args[0], &args[1]);
+                switch (op) {
+                    case BUILTIN_NUM_EQ: holds &= c == 0; break;
+                    case BUILTIN_LT:     holds &= c < 0;  break;
+                    case BUILTIN_LE:     holds &= c <= 0; break;
+                    case BUILTIN_GT:     holds &= c > 0;  break;
+                    default:             holds &= c >= 0; break;
                 }
-            } else if (strcmp(op, "*") == 0) {
-                acc = 1;
-                while (1) {
-                    Marker *curr = (Marker *)buffer_nth(buf, *index);
-                    if (!curr) {
-                        fprintf(stderr, "Error: Unexpected end of expression.\n");
-                        return RETURN_STATUS_RUNTIME_ERROR;
-                    }
-                    if (curr->type == MARKER_RPAREN) {
-                        (*index)++;  // Consume ')'
-                        break;
-                    }
-                    int tmp;
-                    status = eval_expr(index, buf, input, &tmp);
-                    if (status != RETURN_STATUS_SUCCESS)
+                args[0] = args[1];
+            }
+            (*index)++;  // Consume ')'
+            result->type = VALUE_BOOL;
+            result->as.i = holds;
+            return RETURN_STATUS_SUCCESS;
+        }
+        case BUILTIN_IF:
+            // (if test then [else]); a missing else yields nil.
+            if ((status = eval_expr(interp, index, &args[0])) != RETURN_STATUS_SUCCESS)
+                return status;
+            if (value_is_true(&args[0])) {
+                if ((status = eval_expr(interp, index, result)) != RETURN_STATUS_SUCCESS)
+                    return status;
+                if (!at_rparen(interp, *index) && (status = skip_expr(interp, index)) != RETURN_STATUS_SUCCESS)
+                    return status;
+            } else {
+                if ((status = skip_expr(interp, index)) != RETURN_STATUS_SUCCESS)
+                    return status;
+                *result = NIL_VALUE;
+                if (!at_rparen(interp, *index) && (status = eval_expr(interp, index, result)) != RETURN_STATUS_SUCCESS)
+                    return status;
+            }
+            return expect_rparen(interp, index) ? RETURN_STATUS_SUCCESS : RETURN_STATUS_RUNTIME_ERROR;
+        case BUILTIN_COND:
+            // (cond (test expr ...) ... [(else expr ...)]); a clause without
+            // exprs yields its test value, and no matching clause yields nil.
+            while (!at_rparen(interp, *index)) {
+                size_t clause = *index;
+                Marker *m = (Marker *)buffer_nth(interp->markers, clause);
+                if (!m || m->type != MARKER_LPAREN) {
+                    fprintf(stderr, "Error: Expected a cond clause.\n");
+                    return RETURN_STATUS_RUNTIME_ERROR;
+                }
+                (*index)++;  // Consume '('.
+                if (at_else(interp, *index)) {
+                    (*index)++;  // Consume else.
+                    args[0] = NIL_VALUE;
+                } else if ((status = eval_expr(interp, index, &args[0])) != RETURN_STATUS_SUCCESS) {
+                    return status;
+                } else if (!value_is_true(&args[0])) {
+                    if ((status = skip_form(interp, clause, index)) != RETURN_STATUS_SUCCESS)
                         return status;
-                    acc *= tmp;
+                    continue;
                 }
-            } else {
-                fprintf(stderr, "Error: Unsupported operator '%s'\n", op);
-                return RETURN_STATUS_RUNTIME_ERROR;
+                *result = args[0];
+                while (!at_rparen(interp, *index)) {
+                    if ((status = eval_expr(interp, index, result)) != RETURN_STATUS_SUCCESS)
+                        return status;
+                }
+                (*index)++;  // Consume the clause's ')'.
+                return skip_form(interp, form, index);
             }
-            *result = acc;
+            (*index)++;  // Consume ')'
+            *result = NIL_VALUE;
             return RETURN_STATUS_SUCCESS;
-        }
+        case BUILTIN_AND:
+        case BUILTIN_OR:
+            // The first false (and) or true (or) value ends the form.
+            result->type = VALUE_BOOL;
+            result->as.i = op == BUILTIN_AND;
+            while (!at_rparen(interp, *index)) {
+                if ((status = eval_expr(interp, index, result)) != RETURN_STATUS_SUCCESS)
+                    return status;
+                if (value_is_true(result) != (op == BUILTIN_AND))
+                    return skip_form(interp, form, index);
+            }
+            (*index)++;  // Consume ')'
+            return RETURN_STATUS_SUCCESS;
+        case BUILTIN_WHEN:
+            // (when test expr ...) yields the last expr, or nil when test is false.
+            if ((status = eval_expr(interp, index, &args[0])) != RETURN_STATUS_SUCCESS)
+                return status;
+            *result = NIL_VALUE;
+            if (!value_is_true(&args[0]))
+                return skip_form(interp, form, index);
+            while (!at_rparen(interp, *index)) {
+                if ((status = eval_expr(interp, index, result)) != RETURN_STATUS_SUCCESS)
+                    return status;
+            }
+            (*index)++;  // Consume ')'
+            return RETURN_STATUS_SUCCESS;
+        case BUILTIN_ELSE:
+            fprintf(stderr, "Error: else outside of cond.\n");
+            return RETURN_STATUS_RUNTIME_ERROR;
+        default:
+            return RETURN_STATUS_RUNTIME_ERROR;
+    }
+}
+
+static ReturnStatus eval_compound(Interp *interp, size_t *index, Value *result) {
+    size_t form = *index;
+    (*index)++;  // Consume '('.
+
+    // Next marker must be an operator (a symbol).
+    Marker *opMarker = (Marker *)buffer_nth(interp->markers, *index);
+    if (!opMarker || opMarker->type != MARKER_SYMBOL) {
+        fprintf(stderr, "Error: Expected operator symbol after '('.\n");
+        return RETURN_STATUS_RUNTIME_ERROR;
+    }
+    size_t op;
+    ReturnStatus status = marker_symbol(interp, *index, opMarker, &op);
+    if (status != RETURN_STATUS_SUCCESS)
+        return status;
+    if (op >= BUILTIN_COUNT) {
+        fprintf(stderr, "Error: Unsupported operator '%.*s'\n",
+                (int)(opMarker->eidx - opMarker->bidx), interp->input + opMarker->bidx);
+        return RETURN_STATUS_RUNTIME_ERROR;
+    }
+    (*index)++;  // Consume operator.
+
+    size_t mark = interp->heap.roots->count;
+    status = eval_builtin(interp, (Builtin)op, form, index, result);
+    heap_root_restore(&interp->heap, mark);
+    return status;
+}
+
+/*
+ * Recursive evaluator.
+ *
+ * Parameters:
+ *   interp - interpreter state; interp->markers and interp->input hold the program.
+ *   index  - pointer to the current position in the marker buffer.
+ *   result - output parameter to hold the computed value.
+ *
+ * Returns a ReturnStatus indicating success or error.
+ */
+static ReturnStatus eval_expr(Interp *interp, size_t *index, Value *result) {
+    Marker *m = (Marker *)buffer_nth(interp->markers, *index);
+    if (!m) {
+        fprintf(stderr, "Error: Unexpected end of marker buffer.\n");
+        return RETURN_STATUS_RUNTIME_ERROR;
+    }
+    
+    switch (m->type) {
+        case MARKER_INT:
+        case MARKER_FLOAT:
+        case MARKER_STRING:
+        case MARKER_TRUE:
+        case MARKER_FALSE:
+        case MARKER_NIL:
+            (*index)++; // Consume literal marker.
+            return atom_value(interp, *index - 1, result);
+        case MARKER_SYMBOL:
+            fprintf(stderr, "Error: Unbound symbol '%.*s'\n",
+                    (int)(m->eidx - m->bidx), interp->input + m->bidx);
+            (*index)++;
+            return RETURN_STATUS_RUNTIME_ERROR;
+        case MARKER_QUOTE:
+            (*index)++; // Consume '.
+            return read_datum(interp, index, result);
+        case MARKER_QUASI_QUOTE:
+            (*index)++; // Consume `.
+            return eval_template(interp, index, 1, result);
+        case MARKER_LPAREN:
+            return eval_compound(interp, index, result);
         case MARKER_RPAREN: {
             fprintf(stderr, "Error: Unexpected ')'\n");
             (*index)++;
@@ -395,25 +1305,163 @@ ReturnStatus eval_expr(size_t *index, Buffer *buf, const char *input, int *resul
     }
 }
 
+/*
+ * Evaluate the top-level expression starting at *index. A heap value in
+ * result stays valid until the next evaluation on the same interpreter.
+ */
+ReturnStatus interp_eval(Interp *interp, Buffer *markers, const char *input, size_t *index, Value *result) {
+    interp->markers = markers;
+    interp->input = input;
+    interp->image = NULL;
+    return eval_expr(interp, index, result);
+}
+
+/*
+ * Same as interp_eval, for a program loaded from an image. Literals and
+ * symbols come from the image's tables instead of being decoded from input.
+ * The image is bound to the first interpreter that evaluates it.
+ */
+ReturnStatus interp_eval_image(Interp *interp, Image *image, const char *input, size_t *index, Value *result) {
+    if (!image->symbol_map) {
+        ReturnStatus status = image_bind(image, &interp->symbols);
+        if (status != RETURN_STATUS_SUCCESS)
+            return status;
+    }
+    interp->markers = &image->markers;
+    interp->input = input;
+    interp->image = image;
+    return eval_expr(interp, index, result);
+}
+
+/*
+ * value_print: Write a value in its readable form to out.
+ */
+void value_print(Interp *interp, const Value *value, FILE *out) {
+    switch (value->type) {
+        case VALUE_NIL:
+            fprintf(out, "nil");
+            break;
+        case VALUE_BOOL:
+            fprintf(out, value->as.i ? "#t" : "#f");
+            break;
+        case VALUE_INT:
+        case VALUE_BIGNUM:
+            bignum_print(value, out);
+            break;
+        case VALUE_SYMBOL: {
+            const Symbol *sym = symbol_get(&interp->symbols, value->as.symbol);
+            fprintf(out, "%s", sym ? sym->name : "<unknown symbol>");
+            break;
+        }
+        case VALUE_STRING:
+            fputc('"', out);
+            for (size_t i = 0; i < value->as.string.len; i++) {
+                char c = value->as.string.ptr[i];
+                switch (c) {
+                    case '"':  fprintf(out, "\\\""); break;
+                    case '\\': fprintf(out, "\\\\"); break;
+                    case '\n': fprintf(out, "\\n"); break;
+                    case '\t': fprintf(out, "\\t"); break;
+                    case '\r': fprintf(out, "\\r"); break;
+                    default:   fputc(c, out); break;
+                }
+            }
+            fputc('"', out);
+            break;
+        case VALUE_CONS: {
+            fprintf(out, "(");
+            const Value *cur = value;
+            while (1) {
+                value_print(interp, &cur->as.cons->car, out);
+                cur = &cur->as.cons->cdr;
+                if (cur->type != VALUE_CONS)
+                    break;
+                fprintf(out, " ");
+            }
+            if (cur->type != VALUE_NIL) {
+                fprintf(out, " . ");
+                value_print(interp, cur, out);
+            }
+            fprintf(out, ")");
+            break;
+        }
+        default:
+            fprintf(out, "<invalid>");
+            break;
+    }
+}
+
 /*
  * eval_buffer: Evaluate all top-level expressions in the marker buffer.
- * For each expression found in the buffer, eval_expr is called recursively,
- * and its result is printed.
+ * Macros are expanded first; then for each expression found in the buffer,
+ * eval_expr is called recursively, and its result is printed.
  */
-ReturnStatus eval_buffer(Buffer *marker_buffer, const char *input) {
+ReturnStatus eval_buffer(Interp *interp, Buffer *marker_buffer, const char *input) {
+    Buffer *text __attribute__ ((__cleanup__(buffer_cleanup))) = buffer_create(sizeof(char), 256);
+    Buffer *expanded __attribute__ ((__cleanup__(buffer_cleanup))) = buffer_create(sizeof(Marker), 64);
+    if (!text || !expanded)
+        return RETURN_STATUS_RUNTIME_ERROR;
+    ReturnStatus status = interp_expand(interp, marker_buffer, input, text, expanded);
+    if (status != RETURN_STATUS_SUCCESS) {
+        fprintf(stderr, "Error expanding macros\n");
+        return status;
+    }
+    if (text->count > 0) {
+        marker_buffer = expanded;
+        input = text->data;
+    }
     size_t index = 0;
     while (index < marker_buffer->count) {
-        int result;
-        ReturnStatus status = eval_expr(&index, marker_buffer, input, &result);
+        Value result;
+        status = interp_eval(interp, marker_buffer, input, &index, &result);
         if (status != RETURN_STATUS_SUCCESS) {
             fprintf(stderr, "Error evaluating expression starting at marker index %zu\n", index);
             return status;
         }
-        printf("Evaluated result: %d\n", result);
+        printf("Evaluated result: ");
+        value_print(interp, &result, stdout);
+        printf("\n");
     }
     return RETURN_STATUS_SUCCESS;
 }
 
+/*
+ * Integer value of an INT or FLOAT marker. Floats are truncated and values
+ * outside int64 saturate; the evaluator reads long INT literals as bignums.
+ */
+int64_t marker_int_value(const Marker *marker, const char *input) {
+    if (marker->type == MARKER_FLOAT) {
+        double d = atof(input + marker->bidx);
+        return d >= 0x1p63 ? INT64_MAX : d < -0x1p63 ? INT64_MIN : (int64_t)d;
+    }
+    return strtoll(input + marker->bidx, NULL, 10);
+}
+
+/*
+ * Decode the escapes in the body of a string literal (quotes excluded).
+ * out needs room for len bytes; the decoded length is returned.
+ */
+size_t string_decode(const char *raw, size_t len, char *out) {
+    size_t n = 0;
+    for (size_t i = 0; i < len; i++) {
+        char c = raw[i];
+        if (c == '\\' && i + 1 < len) {
+            c = raw[++i];
+            switch (c) {
+                case 'n': c = '\n'; break;
+                case 't': c = '\t'; break;
+                case 'r': c = '\r'; break;
+                case '0': c = '\0'; break;
+                case 'a': c = '\a'; break;
+                case 'b': c = '\b'; break;
+                default:  break;  // \" \\ and unknown escapes stand for the character.
+            }
+        }
+        out[n++] = c;
+    }
+    return n;
+}
+
 /*
  * Helper function to convert a MarkerType into a readable string.
  */
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
 
 typedef enum {
   MARKER_LPAREN,
@@ -25,6 +27,7 @@ typedef enum {
 typedef struct {
   size_t bidx;
   size_t eidx;
+  size_t jump;  // Index just past the datum this marker begins; for ')' its '(' (SIZE_MAX if none)
   MarkerType type;
 } Marker;
 
@@ -53,12 +56,318 @@ Buffer* buffer_create(size_t element_size, size_t initial_capacity);
 void buffer_destroy(Buffer *buf);
 void buffer_cleanup(Buffer **buf);
 int buffer_push(Buffer *buf, const void *element);
+int buffer_extend(Buffer *buf, const void *elements, size_t n);
 void* buffer_nth(Buffer *buf, size_t n);
 int buffer_pop(Buffer *buf, void *element_out);
 void buffer_clear(Buffer *buf);
 
+/*
+  Struct layouts: fields are laid out once at definition time so every
+  field access is a fixed offset from the record base.
+*/
+#define STRUCT_NAME_MAX   32
+#define STRUCT_FIELDS_MAX 32
+
+typedef enum {
+  FIELD_I8,
+  FIELD_I16,
+  FIELD_I32,
+  FIELD_I64,
+  FIELD_U8,
+  FIELD_U16,
+  FIELD_U32,
+  FIELD_U64,
+  FIELD_F32,
+  FIELD_F64,
+} FieldType;
+
+typedef struct {
+    char      name[STRUCT_NAME_MAX];
+    FieldType type;
+    size_t    size;    // Size in bytes (also the field's alignment)
+    size_t    offset;  // Byte offset inside an array-of-structs record
+} StructField;
+
+typedef struct {
+    char        name[STRUCT_NAME_MAX];
+    StructField fields[STRUCT_FIELDS_MAX]; // In declaration order
+    size_t      field_count;
+    size_t      size;   // Record size including tail padding
+    size_t      align;  // Alignment of the whole record
+} StructLayout;
+
+typedef enum {
+  STRUCT_STORAGE_AOS,  // One contiguous record per element
+  STRUCT_STORAGE_SOA,  // One contiguous column per field
+} StructStorage;
+
+/*
+  StructRegistry: Struct definitions, newest last
+*/
+typedef struct {
+    Buffer *layouts;  // StructLayout*, so layouts never move once handed out
+} StructRegistry;
+
+/*
+  StructVec: Resizable vector of struct records in either storage mode
+*/
+typedef struct {
+    const StructLayout *layout;
+    StructStorage storage;
+    void   *data;
+    size_t capacity;
+    size_t count;
+    size_t columns[STRUCT_FIELDS_MAX]; // SoA only: byte offset of each field's column
+} StructVec;
+
+/* Struct layout functions */
+const char *field_type_to_string(FieldType type);
+int field_type_from_string(const char *name, size_t len, FieldType *type_out);
+ReturnStatus struct_layout_init(StructLayout *layout, const char *name, size_t len);
+ReturnStatus struct_layout_add_field(StructLayout *layout, const char *name, size_t len, FieldType type);
+void struct_layout_finish(StructLayout *layout);
+const StructField *struct_layout_field(const StructLayout *layout, const char *name, size_t len);
+ReturnStatus struct_register(StructRegistry *registry, const StructLayout *layout);
+const StructLayout *struct_lookup(StructRegistry *registry, const char *name, size_t len);
+void struct_registry_destroy(StructRegistry *registry);
+ReturnStatus struct_define_from_markers(StructRegistry *registry, size_t *index, Buffer *buf,
+                                        const char *input, const StructLayout **layout_out);
+
+/* StructVec functions */
+StructVec* struct_vec_create(const StructLayout *layout, StructStorage storage, size_t initial_capacity);
+void struct_vec_destroy(StructVec *vec);
+void struct_vec_cleanup(StructVec **vec);
+int struct_vec_push(StructVec *vec, const void *record);
+void* struct_vec_field(StructVec *vec, size_t n, size_t field);
+void* struct_vec_column(StructVec *vec, size_t field, size_t *stride_out);
+
+/*
+  Symbols: interned names, identified by their index in the table
+*/
+typedef struct {
+    const char *name;  // Owned, NUL-terminated copy
+    size_t len;
+} Symbol;
+
+typedef struct {
+    Buffer *symbols;    // Symbol, indexed by symbol id
+    size_t *slots;      // Open addressing: 0 = empty, otherwise id + 1
+    size_t slot_count;  // Always a power of two
+} SymbolTable;
+
+/* Symbol table functions */
+ReturnStatus symbol_table_init(SymbolTable *table);
+void symbol_table_destroy(SymbolTable *table);
+ReturnStatus symbol_intern(SymbolTable *table, const char *name, size_t len, size_t *id_out);
+const Symbol *symbol_get(SymbolTable *table, size_t id);
+
+/*
+  Values
+*/
+typedef enum {
+  VALUE_NIL,
+  VALUE_BOOL,
+  VALUE_INT,
+  VALUE_SYMBOL,
+  VALUE_STRING,
+  VALUE_CONS,
+  VALUE_BIGNUM,   // Integer outside the int64 range
+  VALUE_FORWARD,  // GC internal: object already copied, new address in as.cons or as.bignum
+  VALUE_HEADER,   // GC internal: first word of a heap object that is not a cons
+} ValueType;
+
+typedef struct Cons Cons;
+typedef struct Bignum Bignum;
+
+typedef struct {
+    ValueType type;
+    union {
+        int64_t i;      // VALUE_INT, VALUE_BOOL
+        size_t symbol;  // VALUE_SYMBOL: id in the interpreter's SymbolTable
+        struct {
+            const char *ptr;  // VALUE_STRING: decoded bytes, interned per interpreter
+            size_t len;
+        } string;
+        Cons  *cons;    // VALUE_CONS, VALUE_FORWARD
+        Bignum *bignum; // VALUE_BIGNUM, VALUE_FORWARD
+    } as;
+} Value;
+
+struct Cons {
+    Value car;
+    Value cdr;
+};
+
+/*
+  Bignum: Arbitrary-precision integer in the GC heap, immutable once built.
+  Integers that fit in int64 are always VALUE_INT, so a bignum is never
+  equal to an int.
+*/
+struct Bignum {
+    Value header;       // VALUE_HEADER; overlays Cons.car so the collector can tell objects apart
+    size_t len;         // Limbs in use; the most significant one is nonzero
+    int negative;
+    uint64_t limbs[];   // Magnitude, least significant limb first
+};
+
+/*
+  Heap: Bump-allocated semispaces with a Cheney copying collector. Objects
+  are conses and bignums, each taking a whole number of Cons-sized units.
+
+  Roots are the addresses of Value slots registered by the evaluator. A
+  collection can run inside any allocation, so a Value that refers to the
+  heap must sit in a registered slot across every call that may allocate.
+*/
+typedef struct {
+    size_t   collections;
+    size_t   cons_allocated;
+    size_t   bignums_allocated;
+    size_t   bytes_allocated;
+    size_t   bytes_copied;
+    uint64_t pause_ns_total;
+    uint64_t pause_ns_max;
+    uint64_t created_ns;  // Monotonic time the heap was created
+} HeapStats;
+
+typedef struct {
+    char   *space;       // Current semispace, allocation happens here
+    char   *free;        // Bump pointer into space
+    char   *limit;       // End of space
+    char   *reserve;     // The other semispace, target of the next collection
+    size_t semispace_size;
+    Buffer *roots;       // Value*, registered root slots
+    HeapStats stats;
+} Heap;
+
+#define HEAP_INITIAL_SEMISPACE (256 * 1024)
+
+/* Heap functions */
+ReturnStatus heap_init(Heap *heap, size_t semispace_size);
+void heap_destroy(Heap *heap);
+int heap_root_push(Heap *heap, Value *slot);
+void heap_root_restore(Heap *heap, size_t mark);
+ReturnStatus heap_cons(Heap *heap, const Value *car, const Value *cdr, Value *out);
+ReturnStatus heap_bignum(Heap *heap, size_t len, Value *out);
+ReturnStatus heap_collect(Heap *heap, size_t min_free);
+void heap_print_stats(const Heap *heap);
+
+/* Bignum functions: operands may be VALUE_INT or VALUE_BIGNUM, results are
+   normalized to VALUE_INT when they fit. Heap operands must be in root
+   slots; out may alias them. */
+ReturnStatus bignum_parse(Heap *heap, const char *text, size_t len, Value *out);
+ReturnStatus bignum_add(Heap *heap, const Value *a, const Value *b, Value *out);
+ReturnStatus bignum_sub(Heap *heap, const Value *a, const Value *b, Value *out);
+ReturnStatus bignum_mul(Heap *heap, const Value *a, const Value *b, Value *out);
+int bignum_compare(const Value *a, const Value *b);
+void bignum_print(const Value *value, FILE *out);
+
+/*
+  Image: Precompiled marker buffer for one source file, mapped from disk
+  and used in place. All references inside the file are offsets from its
+  start, so the mapping may land anywhere.
+*/
+#define IMAGE_VERSION 4
+
+typedef struct {
+    uint64_t offset;  // Offset in the image's byte pool
+    uint64_t len;
+} ImageString;
+
+typedef struct {
+    void   *base;                // Mapping of the whole file
+    size_t size;
+    Buffer markers;              // Read-only view of the mapped Marker array
+    const int64_t *literals;     // Per marker: integer value, symbol index or string index
+    const ImageString *symbols;
+    size_t symbol_count;
+    const ImageString *strings;  // Decoded string literals
+    size_t string_count;
+    const char *pool;            // Symbol names and decoded strings
+    size_t *symbol_map;          // Image symbol index -> interpreter symbol id (image_bind)
+    size_t *string_map;          // Image string index -> interpreter string id, filled lazily
+} Image;
+
+/* Image functions */
+ReturnStatus image_write(const char *path, const char *source, size_t source_len, Buffer *markers);
+ReturnStatus image_open(Image *image, const char *path, const char *source, size_t source_len);
+ReturnStatus image_bind(Image *image, SymbolTable *symbols);
+void image_close(Image *image);
+
+/*
+  Macros: syntax-rules macros, expanded by a source-to-source pass before
+  evaluation (expand.c)
+*/
+typedef struct {
+    char *source;        // Owned copy of the define-syntax form
+    Buffer *markers;     // Marker, lexed from source
+    const char *name;    // Keyword, inside source
+    size_t name_len;
+    size_t literals;     // Marker index of the literals list
+    size_t rules;        // Marker index of the first (pattern template) rule
+    size_t rules_end;    // Marker index of the ')' after the last rule
+} Macro;
+
+typedef struct {
+    size_t calls;        // Macro calls expanded, cached ones included
+    size_t cache_hits;
+    size_t templates;    // Quasiquote templates walked
+    uint64_t ns;         // Time spent in interp_expand
+} ExpandStats;
+
+#define EXPAND_CACHE_MAX (16u * 1024 * 1024)  // Bytes cached before the cache is dropped
+
+typedef struct {
+    Buffer *macros;      // Macro
+    SymbolTable cache;   // Text of a macro call -> index in expansions
+    Buffer *expansions;  // char *, owned full expansion of each call (NULL if none yet)
+    size_t cache_bytes;  // Call text plus expansions held by the cache
+    size_t generation;   // Bumped whenever the cache is cleared
+    ExpandStats stats;
+} Expander;
+
+/* Expander functions */
+ReturnStatus expander_init(Expander *expander);
+void expander_destroy(Expander *expander);
+
+/*
+  Interp: Interpreter state that persists across evaluated expressions
+*/
+typedef struct {
+    Heap heap;
+    SymbolTable symbols;
+    StructRegistry structs;
+    SymbolTable strings;      // Interned string values; equal strings share one copy
+    Buffer *scratch;          // char, reused for decoding escaped string literals
+    Buffer *markers;          // Program being evaluated
+    const char *input;
+    Image *image;             // Image the program was loaded from, or NULL
+    Expander expander;
+} Interp;
+
+/* Interpreter functions */
+ReturnStatus interp_init(Interp *interp);
+void interp_destroy(Interp *interp);
+ReturnStatus interp_eval(Interp *interp, Buffer *markers, const char *input, size_t *index, Value *result);
+ReturnStatus interp_eval_image(Interp *interp, Image *image, const char *input, size_t *index, Value *result);
+void value_print(Interp *interp, const Value *value, FILE *out);
+ReturnStatus interp_expand(Interp *interp, Buffer *markers, const char *input, Buffer *text, Buffer *expanded);
+
+/*
+  Server protocol: every request and response is a frame, a 4-byte
+  big-endian payload length followed by the payload. A request payload is
+  a batch of expressions; its response holds one printed result per line.
+  The server keeps state: top-level define-syntax and struct forms of a
+  batch that evaluates without error are visible to every later request,
+  on any connection.
+*/
+#define TAU_SOCKET_PATH   "/tmp/tau.sock"
+#define TAU_FRAME_HEADER  4
+#define TAU_FRAME_MAX     (16u * 1024 * 1024)
+
 /* Scheme functions */
 ReturnStatus read_markers(const char* input_string, Buffer* output_buffer);
-ReturnStatus eval_buffer(Buffer *marker_buffer, const char *input);
+ReturnStatus eval_buffer(Interp *interp, Buffer *marker_buffer, const char *input);
 const char *marker_type_to_string(MarkerType type);
+int64_t marker_int_value(const Marker *marker, const char *input);
+size_t string_decode(const char *raw, size_t len, char *out);
 void pretty_print_markers(Buffer *marker_buffer, const char *input);
@@ -0,0 +1,457 @@
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "tau.h"
+
+/*
+ * Regression tests. Run all of them with `./test_tau`, or a single one
+ * with `./test_tau <name>`. Built with the sanitizers, so a stale heap
+ * pointer fails loudly rather than printing a wrong value.
+ */
+
+static int failures;
+
+/* Stale root slots point into dead frames; make ASan see those frames as dead. */
+const char *__asan_default_options(void) {
+    return "detect_stack_use_after_return=1";
+}
+
+/*
+ * Expand and evaluate every expression in source and compare the printed
+ * value of the last one with expected.
+ */
+static void check(Interp *interp, const char *source, const char *expected) {
+    Buffer *buf __attribute__ ((__cleanup__(buffer_cleanup))) = buffer_create(sizeof(Marker), 64);
+    Buffer *text __attribute__ ((__cleanup__(buffer_cleanup))) = buffer_create(sizeof(char), 64);
+    Buffer *expanded __attribute__ ((__cleanup__(buffer_cleanup))) = buffer_create(sizeof(Marker), 64);
+    char *printed = NULL;
+    size_t len = 0;
+    FILE *out = open_memstream(&printed, &len);
+    int ok = buf && text && expanded && out && read_markers(source, buf) == RETURN_STATUS_SUCCESS &&
+             interp_expand(interp, buf, source, text, expanded) == RETURN_STATUS_SUCCESS;
+    const char *input = ok && text->count ? (const char *)text->data : source;
+    Buffer *markers = ok && text->count ? expanded : buf;
+    size_t index = 0;
+    while (ok && index < markers->count) {
+        Value result;
+        ok = interp_eval(interp, markers, input, &index, &result) == RETURN_STATUS_SUCCESS;
+        if (ok && index == markers->count)
+            value_print(interp, &result, out);
+    }
+    if (out)
+        fclose(out);
+    if (!ok || !printed || strcmp(printed, expected) != 0) {
+        fprintf(stderr, "FAIL: %s\n  expected: %s\n  got:      %s\n",
+                source, expected, ok && printed ? printed : "(error)");
+        failures++;
+    }
+    free(printed);
+}
+
+/* Shrink interp's heap to a few cells so nearly every allocation collects. */
+static void tiny_heap(Interp *interp) {
+    heap_destroy(&interp->heap);
+    if (heap_init(&interp->heap, 4 * sizeof(Cons)) != RETURN_STATUS_SUCCESS) {
+        fprintf(stderr, "Error creating test heap\n");
+        exit(1);
+    }
+}
+
+/* "(op '((0) (1) .. (n-1)))" and the list it prints as. */
+static void list_of_lists(const char *op, int n, int reversed, char *source, char *printed) {
+    char *s = source + sprintf(source, "(%s '(", op), *p = printed + sprintf(printed, "(");
+    for (int i = 0; i < n; i++) {
+        s += sprintf(s, "(%d) ", i);
+        p += sprintf(p, "%s(%d)", i ? " " : "", reversed ? n - 1 - i : i);
+    }
+    strcpy(s, "))");
+    strcpy(p, ")");
+}
+
+/* Builtins that copy values out of conses while allocating new ones. */
+static void test_gc_stress(void) {
+    Interp interp __attribute__ ((__cleanup__(interp_destroy)));
+    if (interp_init(&interp) != RETURN_STATUS_SUCCESS)
+        exit(1);
+    tiny_heap(&interp);
+
+    static char source[4096], printed[4096];
+    for (int round = 0; round < 20; round++) {
+        list_of_lists("reverse", 64, 1, source, printed);
+        check(&interp, source, printed);
+        list_of_lists("append", 64, 0, source, printed);
+        check(&interp, source, printed);
+    }
+    check(&interp, "(append '((1) (2)) (list (list 3) (cons 4 nil)) '((5)))", "((1) (2) (3) (4) (5))");
+    check(&interp, "`((a) ,@(list (list 1) (list 2)) ,(reverse '((3) (4))))", "((a) (1) (2) ((4) (3)))");
+    check(&interp, "(reverse (list (* 99999999999 99999999999) (list 1 2) (+ 1 2)))",
+          "(3 (1 2) 9999999999800000000001)");
+
+    // The heap above has grown; these need collections on their very first cons.
+    Interp fresh __attribute__ ((__cleanup__(interp_destroy)));
+    if (interp_init(&fresh) != RETURN_STATUS_SUCCESS)
+        exit(1);
+    tiny_heap(&fresh);
+    check(&fresh, "(append (list (list 1) (list 2)) (list (list 3) (list 4) (list 5) (list 6) (list 7)) (list 8))",
+          "((1) (2) (3) (4) (5) (6) (7) 8)");
+    check(&fresh, "`(,@(list (list 1) (list 2)) ,@(list (list 3) (list 4) (list 5)) (6))",
+          "((1) (2) (3) (4) (5) (6))");
+}
+
+/* Literal parsing around the int64 edge and the int/bignum comparison paths. */
+static void test_numbers(void) {
+    Interp interp __attribute__ ((__cleanup__(interp_destroy)));
+    if (interp_init(&interp) != RETURN_STATUS_SUCCESS)
+        exit(1);
+    check(&interp, "(+ -5 +7 0 -0)", "2");
+    check(&interp, "999999999999999999", "999999999999999999");
+    check(&interp, "-999999999999999999", "-999999999999999999");
+    check(&interp, "+9223372036854775807", "9223372036854775807");
+    check(&interp, "-9223372036854775808", "-9223372036854775808");
+    check(&interp, "9223372036854775808", "9223372036854775808");
+    check(&interp, "(+ 9223372036854775807 1)", "9223372036854775808");
+    check(&interp, "(- -9223372036854775808 1)", "-9223372036854775809");
+    check(&interp, "(< -3 -2 0 5 9223372036854775808)", "#t");
+    check(&interp, "(> 100000000000000000000 9223372036854775807 -1)", "#t");
+    check(&interp, "(= 5 5 6)", "#f");
+    check(&interp, "(<= 1 1 2 (* 2 1))", "#t");
+    check(&interp, "(>= (* 4294967296 4294967296) 18446744073709551616)", "#t");
+}
+
+/* A stream of distinct macro calls keeps the expansion cache bounded. */
+static void test_expand_cache(void) {
+    Interp interp __attribute__ ((__cleanup__(interp_destroy)));
+    if (interp_init(&interp) != RETURN_STATUS_SUCCESS)
+        exit(1);
+    check(&interp, "(define-syntax swap (syntax-rules () ((_ a b) (list b a))))", "swap");
+    static char source[512], printed[512];
+    size_t peak = 0;
+    for (int i = 0; i < 40000; i++) {
+        sprintf(source, "(swap \"%0256d\" 1)", i);
+        sprintf(printed, "(1 \"%0256d\")", i);
+        check(&interp, source, printed);
+        if (interp.expander.cache_bytes > peak)
+            peak = interp.expander.cache_bytes;
+    }
+    check(&interp, "(swap 1 2)", "(2 1)");
+    check(&interp, "(swap 1 2)", "(2 1)");
+    if (peak > EXPAND_CACHE_MAX + 1024 || interp.expander.stats.cache_hits != 1) {
+        fprintf(stderr, "FAIL: expansion cache peaked at %zu bytes with %zu hits\n",
+                peak, interp.expander.stats.cache_hits);
+        failures++;
+    }
+}
+
+/*
+ * Overwrite len bytes of the image at path, at the given offset from the
+ * start of its section, and check that image_open now refuses it.
+ */
+static void check_corrupt_image(const char *path, const char *source, size_t offset,
+                                const void *bytes, size_t len, const char *what) {
+    Image image;
+    if (image_open(&image, path, source, strlen(source)) != RETURN_STATUS_SUCCESS) {
+        fprintf(stderr, "FAIL: image for %s does not open\n", what);
+        failures++;
+        return;
+    }
+    image_close(&image);
+    int fd = open(path, O_RDWR);
+    char saved[64];
+    if (fd < 0 || pread(fd, saved, len, offset) != (ssize_t)len || pwrite(fd, bytes, len, offset) != (ssize_t)len) {
+        fprintf(stderr, "Error patching %s\n", path);
+        exit(1);
+    }
+    if (image_open(&image, path, source, strlen(source)) != RETURN_STATUS_RETRYABLE_ERROR) {
+        fprintf(stderr, "FAIL: image with %s was accepted\n", what);
+        failures++;
+        image_close(&image);
+    }
+    if (pwrite(fd, saved, len, offset) != (ssize_t)len)
+        exit(1);
+    close(fd);
+}
+
+/* Corrupt markers and literals are rejected even though the source hash matches. */
+static void test_image_corrupt(void) {
+    static const char *path = "/tmp/tau_test.img";
+    static const char *source = "(list 'a \"b\" (+ 1 2))";
+    Buffer *buf __attribute__ ((__cleanup__(buffer_cleanup))) = buffer_create(sizeof(Marker), 64);
+    if (!buf || read_markers(source, buf) != RETURN_STATUS_SUCCESS ||
+        image_write(path, source, strlen(source), buf) != RETURN_STATUS_SUCCESS) {
+        fprintf(stderr, "Error writing %s\n", path);
+        exit(1);
+    }
+    Image image;
+    if (image_open(&image, path, source, strlen(source)) != RETURN_STATUS_SUCCESS)
+        exit(1);
+    size_t markers = (const char *)image.markers.data - (const char *)image.base;
+    size_t literals = (const char *)image.literals - (const char *)image.base;
+    image_close(&image);
+
+    // Marker 3 is the symbol a, marker 4 the string "b", marker 10 the last ')'.
+    size_t big = 1000, back = 4;
+    int64_t bad = 99;
+    check_corrupt_image(path, source, markers + 3 * sizeof(Marker) + offsetof(Marker, eidx),
+                        &big, sizeof(big), "a marker past the source");
+    check_corrupt_image(path, source, markers + 3 * sizeof(Marker) + offsetof(Marker, jump),
+                        &big, sizeof(big), "a jump past the markers");
+    check_corrupt_image(path, source, markers + 10 * sizeof(Marker) + offsetof(Marker, jump),
+                        &back, sizeof(back), "a ')' jumping to a string");
+    check_corrupt_image(path, source, literals + 3 * sizeof(int64_t), &bad, sizeof(bad),
+                        "a symbol index past the table");
+    check_corrupt_image(path, source, literals + 4 * sizeof(int64_t), &bad, sizeof(bad),
+                        "a string index past the table");
+    remove(path);
+}
+
+/* ----------------------------------------------------------------------
+ * Server: runs ./main_tau_server on a private socket
+ * ---------------------------------------------------------------------- */
+
+static pid_t server_pid;
+static char server_path[64];
+
+static int server_connect(void) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    strcpy(addr.sun_path, server_path);
+    for (int attempt = 0; attempt < 100; attempt++) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+            return fd;
+        if (fd >= 0)
+            close(fd);
+        usleep(20000);  // The server may still be starting.
+    }
+    fprintf(stderr, "Error connecting to %s\n", server_path);
+    exit(1);
+}
+
+static void server_start(const char *workers) {
+    snprintf(server_path, sizeof(server_path), "/tmp/tau_test_%d.sock", (int)getpid());
+    server_pid = fork();
+    if (server_pid == 0) {
+        freopen("/dev/null", "w", stderr);  // Keep the server's log out of the report.
+        execl("./main_tau_server", "main_tau_server", "-w", workers, server_path, (char *)NULL);
+        perror("exec ./main_tau_server");
+        _exit(127);
+    }
+    close(server_connect());
+}
+
+static void server_stop(void) {
+    int status;
+    kill(server_pid, SIGINT);
+    waitpid(server_pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "FAIL: server exited with status %d\n", status);
+        failures++;
+    }
+}
+
+static void send_frame(int fd, const char *payload) {
+    size_t len = strlen(payload);
+    unsigned char header[TAU_FRAME_HEADER] = {
+        (unsigned char)(len >> 24), (unsigned char)(len >> 16), (unsigned char)(len >> 8), (unsigned char)len,
+    };
+    if (write(fd, header, sizeof(header)) != sizeof(header) || write(fd, payload, len) != (ssize_t)len) {
+        fprintf(stderr, "Error sending a request\n");
+        exit(1);
+    }
+}
+
+static int read_exact(int fd, void *data, size_t len) {
+    for (size_t got = 0; got < len;) {
+        ssize_t n = read(fd, (char *)data + got, len - got);
+        if (n <= 0)
+            return 0;
+        got += n;
+    }
+    return 1;
+}
+
+/* The next response payload on fd, malloc'd, or NULL at end of stream. */
+static char *recv_frame(int fd) {
+    unsigned char header[TAU_FRAME_HEADER];
+    if (!read_exact(fd, header, sizeof(header)))
+        return NULL;
+    size_t len = ((size_t)header[0] << 24) | ((size_t)header[1] << 16) | ((size_t)header[2] << 8) | header[3];
+    char *payload = malloc(len + 1);
+    if (!payload || !read_exact(fd, payload, len)) {
+        free(payload);
+        return NULL;
+    }
+    payload[len] = '\0';
+    return payload;
+}
+
+static void check_response(int fd, const char *request, const char *expected) {
+    char *response = recv_frame(fd);
+    if (!response || strcmp(response, expected) != 0) {
+        fprintf(stderr, "FAIL: %s\n  expected: %s\n  got:      %s\n",
+                request, expected, response ? response : "(no response)");
+        failures++;
+    }
+    free(response);
+}
+
+static void request(int fd, const char *payload, const char *expected) {
+    send_frame(fd, payload);
+    check_response(fd, payload, expected);
+}
+
+/* Definitions made on one connection are visible on another, served by another worker. */
+static void test_server_definitions(void) {
+    server_start("2");
+    int a = server_connect(), b = server_connect();
+    request(a, "(define-syntax swap (syntax-rules () ((_ a b) (list b a))))"
+               "(struct point ((x i32) (y i32)))", "swap\n8\n");
+    request(b, "(swap 1 2) (sizeof point)", "(2 1)\n8\n");
+    request(a, "(swap 3 4)", "(4 3)\n");
+    // A failed batch leaves nothing behind, on either worker.
+    request(b, "(define-syntax pair (syntax-rules () ((_ a) (list a a)))) (struct cell ((v i8))) (car 1)",
+            "pair\n1\nerror: evaluation failed at marker 16\n");
+    request(a, "(pair 1)", "error: evaluation failed at marker 1\n");
+    request(b, "(pair 1)", "error: evaluation failed at marker 1\n");
+    request(b, "(sizeof cell)", "error: evaluation failed at marker 2\n");
+    request(b, "(swap 5 6)", "(6 5)\n");
+
+    // Going back to an earlier definition holds everywhere.
+    static const char *m1 = "(define-syntax m (syntax-rules () ((_ x) (list 1 x))))";
+    static const char *m2 = "(define-syntax m (syntax-rules () ((_ x) (list 2 x))))";
+    request(a, m1, "m\n");
+    request(b, m2, "m\n");
+    request(a, m1, "m\n");
+    request(a, "(m 0)", "(1 0)\n");
+    request(b, "(m 0)", "(1 0)\n");
+    request(a, "(struct p ((v i8)))", "1\n");
+    request(b, "(struct p ((v i64)))", "8\n");
+    request(a, "(struct p ((v i8)))", "1\n");
+    request(a, "(sizeof p)", "1\n");
+    request(b, "(sizeof p)", "1\n");
+    close(a);
+    close(b);
+    server_stop();
+}
+
+/* A worker that has interned too much starts over and keeps the definitions. */
+static void test_server_reset(void) {
+    server_start("1");
+    int fd = server_connect();
+    request(fd, "(define-syntax swap (syntax-rules () ((_ a b) (list b a))))", "swap\n");
+    enum { STRINGS = 120000 };
+    char *batch = malloc(STRINGS * 12), *expected = malloc(STRINGS * 12);
+    char *s = batch, *e = expected;
+    for (int i = 0; i < STRINGS; i++) {
+        s += sprintf(s, "\"s%d\" ", i);
+        e += sprintf(e, "\"s%d\"\n", i);
+    }
+    request(fd, batch, expected);
+    request(fd, "(swap 1 2)", "(2 1)\n");
+    free(batch);
+    free(expected);
+    close(fd);
+    server_stop();
+}
+
+/* The connection's requests are answered after the client shuts down its write side. */
+static void test_server_half_close(void) {
+    server_start("1");
+    int fd = server_connect();
+    send_frame(fd, "(+ 1 2)");
+    send_frame(fd, "(list 3 4)");
+    shutdown(fd, SHUT_WR);
+    check_response(fd, "(+ 1 2)", "3\n");
+    check_response(fd, "(list 3 4)", "(3 4)\n");
+    char *extra = recv_frame(fd);
+    if (extra) {
+        fprintf(stderr, "FAIL: expected end of stream after the responses, got: %s\n", extra);
+        failures++;
+    }
+    free(extra);
+    close(fd);
+    server_stop();
+}
+
+/* A client that sends far more than it reads is paused, not buffered without bound. */
+static void test_server_backpressure(void) {
+    server_start("1");
+    int fd = server_connect();
+    enum { REQUESTS = 20000 };
+    pid_t writer = fork();
+    if (writer == 0) {
+        for (int i = 0; i < REQUESTS; i++)
+            send_frame(fd, "(list 1 2 3 4 5 6 7 8)");
+        _exit(0);
+    }
+    int answered = 0;
+    char *response;
+    while (answered < REQUESTS && (response = recv_frame(fd))) {
+        answered += strcmp(response, "(1 2 3 4 5 6 7 8)\n") == 0;
+        free(response);
+        if (answered == 1)
+            usleep(200000);  // Fall behind so the server has to stop reading.
+    }
+    waitpid(writer, NULL, 0);
+    if (answered != REQUESTS) {
+        fprintf(stderr, "FAIL: %d of %d pipelined requests answered\n", answered, REQUESTS);
+        failures++;
+    }
+    close(fd);
+    server_stop();
+}
+
+/* A response longer than TAU_FRAME_MAX becomes an error frame. */
+static void test_server_oversize(void) {
+    server_start("1");
+    int fd = server_connect();
+    static char source[1024];
+    char *s = source + sprintf(source, "(define-syntax twice (syntax-rules () ((_ x) (list x x))))");
+    for (int i = 0; i < 18; i++)
+        s += sprintf(s, "(twice ");
+    s += sprintf(s, "\"%064d\"", 0);
+    for (int i = 0; i < 18; i++)
+        s += sprintf(s, ")");
+    send_frame(fd, source);
+    char *response = recv_frame(fd);
+    if (!response || !strstr(response, "exceeds the frame limit")) {
+        fprintf(stderr, "FAIL: oversized response\n  got: %.80s\n", response ? response : "(no response)");
+        failures++;
+    }
+    free(response);
+    request(fd, "(+ 1 2)", "3\n");
+    close(fd);
+    server_stop();
+}
+
+static const struct {
+    const char *name;
+    void (*run)(void);
+} tests[] = {
+    { "gc-stress", test_gc_stress },
+    { "numbers",   test_numbers },
+    { "expand-cache", test_expand_cache },
+    { "image-corrupt", test_image_corrupt },
+    { "server-definitions", test_server_definitions },
+    { "server-reset",       test_server_reset },
+    { "server-half-close",  test_server_half_close },
+    { "server-backpressure", test_server_backpressure },
+    { "server-oversize",    test_server_oversize },
+};
+
+int main(int argc, char **argv) {
+    const char *only = argc > 1 ? argv[1] : NULL;
+    for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+        if (only && strcmp(only, tests[i].name) != 0)
+            continue;
+        printf("== %s ==\n", tests[i].name);
+        tests[i].run();
+    }
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures != 0;
+}